@@ -0,0 +1,596 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+
+/*
+ * Benchmark of the byte_queue hot paths.
+ *
+ * Every result is printed as one JSON object per line on stdout:
+ *
+ *   {"bench":"single","mode":"locked","pattern":"wrap","payload":64,
+ *    "threads":"1:1","op":"enqueue","ops":..,"ops_per_s":..,"gb_per_s":..,
+ *    "p50_ns":..,"p99_ns":..,"p999_ns":..}
+ *
+ *   bench    single  - one thread runs enqueue/peek/dequeue in turn
+ *            threads - producer and consumer threads run concurrently
+ *            items   - one thread moves uint32_t items one by one
+ *            lines   - one thread enqueues '\n' terminated lines of payload
+ *                      bytes and splits them off again, see op
+ *            lz      - one thread fills an lz_queue_t with log text until the
+ *                      ring is full, then drains it; payload is the block
+ *                      size, bytes are logical (uncompressed) bytes
+ *   mode     locked  - queue_init(), non-cover
+ *            cover   - queue_init() in cover mode, every enqueue overwrites
+ *            spsc    - queue_init_spsc()
+ *            typed   - a DEFINE_TYPED_QUEUE() queue (items only)
+ *   pattern  aligned - accesses never straddle the end of the buffer
+ *            wrap    - every access is shifted by half a payload, so a large
+ *                      share of them is split at the end of the buffer
+ *   op       enqueue/peek/dequeue are timed call by call, the percentiles
+ *            include the cost of reading the clock; cycle is an untimed run
+ *            of the whole enqueue/peek/dequeue sequence, its percentiles
+ *            are null. The lines bench reports its split method as op:
+ *            peek_loop peeks byte by byte up to the '\n' and dequeues the
+ *            line, dequeue_until uses dequeue_until(); both are untimed runs
+ *            of enqueue plus split, their percentiles are null.
+ *
+ * Usage: byte_queue_bench [MiB per run, default 64]
+ */
+#include "byte_queue.h"
+#include "typed_queue.h"
+#include "lz_queue.h"
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <time.h>
+
+#define BENCH_MAX_CYCLES        (200000u)
+#define BENCH_MIN_CYCLES        (1000u)
+/* largest power of two a queue_size_t can hold, 32 KiB without QUEUE_CFG_WIDE_INDEX */
+#define BENCH_MAX_QUEUE_SIZE    ((uint32_t)(queue_size_t)-1 / 2 + 1)
+
+typedef enum {
+    BENCH_LOCKED = 0,
+    BENCH_COVER,
+    BENCH_SPSC,
+    BENCH_TYPED,
+} bench_mode_t;
+
+static const char *c_pchModeName[] = {"locked", "cover", "spsc", "typed"};
+static const uint32_t c_wPayload[] = {1, 16, 64, 256, 1024, 4096, 16384, 65536};
+
+static uint64_t s_dwBudget = 64ull << 20;       /* bytes moved per run */
+
+typedef struct bench_samples_t {
+    uint32_t *pwSample;
+    uint32_t wCount;
+    uint32_t wCapacity;
+    uint64_t dwTotalNs;
+} bench_samples_t;
+
+typedef struct bench_thread_t {
+    pthread_t tThread;
+    byte_queue_t *ptQueue;
+    uint32_t wPayload;
+    uint64_t dwBytes;               /* producer: bytes to send */
+    bench_samples_t tSamples;
+} bench_thread_t;
+
+static uint64_t s_dwTotalBytes;
+static uint64_t s_dwConsumed;
+
+static inline uint64_t __bench_now(void)
+{
+    struct timespec tNow;
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    return (uint64_t)tNow.tv_sec * 1000000000ull + (uint64_t)tNow.tv_nsec;
+}
+
+static void __bench_samples_init(bench_samples_t *ptSamples, uint32_t wCapacity)
+{
+    ptSamples->pwSample = malloc(sizeof(uint32_t) * wCapacity);
+    ptSamples->wCount = 0;
+    ptSamples->wCapacity = wCapacity;
+    ptSamples->dwTotalNs = 0;
+}
+
+static inline void __bench_samples_add(bench_samples_t *ptSamples, uint64_t dwNs)
+{
+    ptSamples->dwTotalNs += dwNs;
+    if (ptSamples->wCount < ptSamples->wCapacity) {
+        ptSamples->pwSample[ptSamples->wCount++] = dwNs > UINT32_MAX ? UINT32_MAX : (uint32_t)dwNs;
+    }
+}
+
+static int __bench_compare(const void *pLeft, const void *pRight)
+{
+    uint32_t wLeft = *(const uint32_t *)pLeft;
+    uint32_t wRight = *(const uint32_t *)pRight;
+    return (wLeft > wRight) - (wLeft < wRight);
+}
+
+static uint32_t __bench_percentile(const bench_samples_t *ptSamples, uint32_t wPerMille)
+{
+    if (0 == ptSamples->wCount) {
+        return 0;
+    }
+    uint64_t dwIndex = (uint64_t)ptSamples->wCount * wPerMille / 1000u;
+    if (dwIndex >= ptSamples->wCount) {
+        dwIndex = ptSamples->wCount - 1;
+    }
+    return ptSamples->pwSample[dwIndex];
+}
+
+/* dwOps operations moving dwBytes bytes in dwElapsedNs */
+static void __bench_report(const char *pchBench, bench_mode_t tMode, const char *pchPattern,
+                           uint32_t wPayload, const char *pchThreads, const char *pchOp,
+                           uint64_t dwOps, uint64_t dwBytes, uint64_t dwElapsedNs,
+                           bench_samples_t *ptSamples)
+{
+    char chLatency[96] = "\"p50_ns\":null,\"p99_ns\":null,\"p999_ns\":null";
+    if (NULL != ptSamples) {
+        qsort(ptSamples->pwSample, ptSamples->wCount, sizeof(uint32_t), __bench_compare);
+        snprintf(chLatency, sizeof(chLatency),
+                 "\"p50_ns\":%" PRIu32 ",\"p99_ns\":%" PRIu32 ",\"p999_ns\":%" PRIu32,
+                 __bench_percentile(ptSamples, 500),
+                 __bench_percentile(ptSamples, 990),
+                 __bench_percentile(ptSamples, 999));
+    }
+    double fSeconds = dwElapsedNs ? (double)dwElapsedNs / 1e9 : 1e-9;
+    printf("{\"bench\":\"%s\",\"mode\":\"%s\",\"pattern\":\"%s\",\"payload\":%" PRIu32
+           ",\"threads\":\"%s\",\"op\":\"%s\",\"ops\":%" PRIu64
+           ",\"ops_per_s\":%.0f,\"gb_per_s\":%.3f,%s}\n",
+           pchBench, c_pchModeName[tMode], pchPattern, wPayload, pchThreads, pchOp, dwOps,
+           (double)dwOps / fSeconds, (double)dwBytes / fSeconds / 1e9, chLatency);
+    fflush(stdout);
+}
+
+static uint32_t __bench_queue_size(uint32_t wPayload, uint32_t wMinimum)
+{
+    uint32_t wSize = wMinimum < BENCH_MAX_QUEUE_SIZE ? wMinimum : BENCH_MAX_QUEUE_SIZE;
+    while (wSize < 2 * wPayload && wSize < BENCH_MAX_QUEUE_SIZE) {
+        wSize <<= 1;
+    }
+    return wSize;
+}
+
+/* payloads that do not fit twice into the largest queue are skipped */
+static bool __bench_payload_fits(uint32_t wPayload)
+{
+    return 2 * wPayload <= BENCH_MAX_QUEUE_SIZE;
+}
+
+static byte_queue_t *__bench_queue_init(byte_queue_t *ptQueue, uint8_t *pchBuffer, uint32_t wSize, bench_mode_t tMode)
+{
+    byte_queue_t *ptResult;
+    if (BENCH_SPSC == tMode) {
+        ptResult = queue_init_spsc(ptQueue, pchBuffer, (queue_size_t)wSize);
+    } else {
+        ptResult = queue_init_byte(ptQueue, pchBuffer, (queue_size_t)wSize, BENCH_COVER == tMode);
+    }
+    if (NULL == ptResult) {
+        fprintf(stderr, "queue init failed: mode %s, size %" PRIu32 "\n", c_pchModeName[tMode], wSize);
+        exit(EXIT_FAILURE);
+    }
+    return ptResult;
+}
+
+/* moves head and tail by half a payload, so accesses straddle the buffer end */
+static void __bench_apply_pattern(byte_queue_t *ptQueue, uint8_t *pchData, uint32_t wPayload, bool bWrap)
+{
+    if (bWrap) {
+        queue_size_t hwShift = (queue_size_t)((wPayload + 1) / 2);
+        enqueue_bytes(ptQueue, pchData, hwShift);
+        dequeue_bytes(ptQueue, pchData, hwShift);
+    }
+}
+
+static void __bench_fill(byte_queue_t *ptQueue, uint8_t *pchData, uint32_t wSize, uint32_t wPayload)
+{
+    while (get_queue_count(ptQueue) < wSize) {
+        uint32_t wLeft = wSize - get_queue_count(ptQueue);
+        enqueue_bytes(ptQueue, pchData, (queue_size_t)(wLeft < wPayload ? wLeft : wPayload));
+    }
+}
+
+static void __bench_single(bench_mode_t tMode, bool bWrap, uint32_t wPayload)
+{
+    const char *pchPattern = bWrap ? "wrap" : "aligned";
+    uint32_t wSize = __bench_queue_size(wPayload, 4096);
+    uint64_t dwCycles = s_dwBudget / wPayload;
+    if (dwCycles > BENCH_MAX_CYCLES) {
+        dwCycles = BENCH_MAX_CYCLES;
+    }
+    if (dwCycles < BENCH_MIN_CYCLES) {
+        dwCycles = BENCH_MIN_CYCLES;
+    }
+    uint8_t *pchBuffer = aligned_alloc(64, wSize);
+    uint8_t *pchData = aligned_alloc(64, wPayload + 64);
+    memset(pchBuffer, 0, wSize);
+    memset(pchData, 0xA5, wPayload);
+    byte_queue_t tQueue;
+    __bench_queue_init(&tQueue, pchBuffer, wSize, tMode);
+    __bench_apply_pattern(&tQueue, pchData, wPayload, bWrap);
+    bool bIsCover = (BENCH_COVER == tMode);
+    if (bIsCover) {
+        __bench_fill(&tQueue, pchData, wSize, wPayload);  // Every enqueue has to overwrite
+    }
+
+    /* untimed cycles: raw throughput */
+    uint64_t dwStart = __bench_now();
+    for (uint64_t i = 0; i < dwCycles; i++) {
+        enqueue_bytes(&tQueue, pchData, (queue_size_t)wPayload);
+        peek_bytes_queue(&tQueue, pchData, (queue_size_t)wPayload);
+        if (bIsCover) {
+            reset_peek(&tQueue);
+        }
+        dequeue_bytes(&tQueue, pchData, (queue_size_t)wPayload);
+        if (bIsCover) {
+            enqueue_bytes(&tQueue, pchData, (queue_size_t)wPayload);  // Stay full
+        }
+    }
+    uint64_t dwElapsed = __bench_now() - dwStart;
+    __bench_report("single", tMode, pchPattern, wPayload, "1:1", "cycle",
+                   dwCycles, dwCycles * wPayload, dwElapsed, NULL);
+
+    /* timed calls: latency distribution of every operation */
+    bench_samples_t tEnqueue, tPeek, tDequeue;
+    __bench_samples_init(&tEnqueue, (uint32_t)dwCycles);
+    __bench_samples_init(&tPeek, (uint32_t)dwCycles);
+    __bench_samples_init(&tDequeue, (uint32_t)dwCycles);
+    for (uint64_t i = 0; i < dwCycles; i++) {
+        uint64_t dwT0 = __bench_now();
+        enqueue_bytes(&tQueue, pchData, (queue_size_t)wPayload);
+        uint64_t dwT1 = __bench_now();
+        peek_bytes_queue(&tQueue, pchData, (queue_size_t)wPayload);
+        uint64_t dwT2 = __bench_now();
+        if (bIsCover) {
+            reset_peek(&tQueue);
+        }
+        uint64_t dwT3 = __bench_now();
+        dequeue_bytes(&tQueue, pchData, (queue_size_t)wPayload);
+        uint64_t dwT4 = __bench_now();
+        if (bIsCover) {
+            enqueue_bytes(&tQueue, pchData, (queue_size_t)wPayload);
+        }
+        __bench_samples_add(&tEnqueue, dwT1 - dwT0);
+        __bench_samples_add(&tPeek, dwT2 - dwT1);
+        __bench_samples_add(&tDequeue, dwT4 - dwT3);
+    }
+    __bench_report("single", tMode, pchPattern, wPayload, "1:1", "enqueue",
+                   dwCycles, dwCycles * wPayload, tEnqueue.dwTotalNs, &tEnqueue);
+    __bench_report("single", tMode, pchPattern, wPayload, "1:1", "peek",
+                   dwCycles, dwCycles * wPayload, tPeek.dwTotalNs, &tPeek);
+    __bench_report("single", tMode, pchPattern, wPayload, "1:1", "dequeue",
+                   dwCycles, dwCycles * wPayload, tDequeue.dwTotalNs, &tDequeue);
+    free(tEnqueue.pwSample);
+    free(tPeek.pwSample);
+    free(tDequeue.pwSample);
+    free(pchData);
+    free(pchBuffer);
+}
+
+DEFINE_TYPED_QUEUE(bench_item_queue, uint32_t, 1024)
+
+/* uint32_t items through the typed queue or the enqueue()/dequeue() macros */
+static void __bench_items(bench_mode_t tMode)
+{
+    uint64_t dwCycles = BENCH_MAX_CYCLES;
+    uint32_t wItem = 0x55AAAA55;
+    uint64_t dwStart;
+    if (BENCH_TYPED == tMode) {
+        static bench_item_queue_t s_tQueue;
+        bench_item_queue_init(&s_tQueue);
+        dwStart = __bench_now();
+        for (uint64_t i = 0; i < dwCycles; i++) {
+            bench_item_queue_push(&s_tQueue, wItem + 1);
+            bench_item_queue_peek(&s_tQueue, &wItem);
+            bench_item_queue_pop(&s_tQueue, &wItem);
+        }
+    } else {
+        uint8_t *pchBuffer = aligned_alloc(64, 4096);
+        byte_queue_t tQueue;
+        __bench_queue_init(&tQueue, pchBuffer, 4096, tMode);
+        dwStart = __bench_now();
+        for (uint64_t i = 0; i < dwCycles; i++) {
+            uint32_t wNext = wItem + 1;
+            enqueue(&tQueue, wNext);
+            peek_queue(&tQueue, &wItem);
+            dequeue(&tQueue, &wItem);
+        }
+        free(pchBuffer);
+    }
+    uint64_t dwElapsed = __bench_now() - dwStart;
+    if (wItem != 0x55AAAA55 + dwCycles) {
+        fprintf(stderr, "items: lost an item\n");
+    }
+    __bench_report("items", tMode, "aligned", sizeof(uint32_t), "1:1", "cycle",
+                   dwCycles, dwCycles * sizeof(uint32_t), dwElapsed, NULL);
+}
+
+/* '\n' terminated lines, split with a per-byte peek loop or dequeue_until() */
+static void __bench_lines(bench_mode_t tMode, uint32_t wPayload, bool bUntil)
+{
+    uint32_t wSize = __bench_queue_size(wPayload, 4096);
+    uint8_t *pchBuffer = aligned_alloc(64, wSize);
+    uint8_t *pchLine = malloc(wPayload);
+    byte_queue_t tQueue;
+    uint64_t dwCycles = s_dwBudget / wPayload;
+    if (dwCycles > BENCH_MAX_CYCLES) {
+        dwCycles = BENCH_MAX_CYCLES;
+    }
+    if (dwCycles < BENCH_MIN_CYCLES) {
+        dwCycles = BENCH_MIN_CYCLES;
+    }
+    memset(pchLine, 'x', wPayload);
+    pchLine[wPayload - 1] = '\n';
+    __bench_queue_init(&tQueue, pchBuffer, wSize, tMode);
+    uint64_t dwBytes = 0;
+    uint64_t dwStart = __bench_now();
+    for (uint64_t i = 0; i < dwCycles; i++) {
+        enqueue_bytes(&tQueue, pchLine, wPayload);
+        if (bUntil) {
+            dwBytes += dequeue_until(&tQueue, '\n', pchLine, wPayload);
+        } else {
+            uint8_t chByte = 0;
+            queue_size_t hwCount = 0;
+            while (chByte != '\n' && 1 == peek_bytes_queue(&tQueue, &chByte, 1)) {
+                hwCount++;
+            }
+            reset_peek(&tQueue);
+            dwBytes += dequeue_bytes(&tQueue, pchLine, hwCount);
+        }
+    }
+    uint64_t dwElapsed = __bench_now() - dwStart;
+    if (dwBytes != dwCycles * wPayload) {
+        fprintf(stderr, "lines: lost a line\n");
+    }
+    __bench_report("lines", tMode, "aligned", wPayload, "1:1", bUntil ? "dequeue_until" : "peek_loop",
+                   dwCycles, dwBytes, dwElapsed, NULL);
+    free(pchLine);
+    free(pchBuffer);
+}
+
+static void *__bench_producer(void *pArg)
+{
+    bench_thread_t *ptThread = pArg;
+    uint8_t *pchData = malloc(ptThread->wPayload);
+    memset(pchData, 0x5A, ptThread->wPayload);
+    uint64_t dwSent = 0;
+    while (dwSent < ptThread->dwBytes) {
+        uint64_t dwLeft = ptThread->dwBytes - dwSent;
+        queue_size_t hwLength = (queue_size_t)(dwLeft < ptThread->wPayload ? dwLeft : ptThread->wPayload);
+        uint64_t dwT0 = __bench_now();
+        queue_size_t hwDone = enqueue_bytes(ptThread->ptQueue, pchData, hwLength);
+        uint64_t dwT1 = __bench_now();
+        if (0 == hwDone) {
+            sched_yield();  // Full or busy, let the other side run
+            continue;
+        }
+        __bench_samples_add(&ptThread->tSamples, dwT1 - dwT0);
+        dwSent += hwDone;
+    }
+    free(pchData);
+    return NULL;
+}
+
+static void *__bench_consumer(void *pArg)
+{
+    bench_thread_t *ptThread = pArg;
+    uint8_t *pchData = malloc(ptThread->wPayload);
+    while (__atomic_load_n(&s_dwConsumed, __ATOMIC_RELAXED) < s_dwTotalBytes) {
+        uint64_t dwT0 = __bench_now();
+        queue_size_t hwDone = dequeue_bytes(ptThread->ptQueue, pchData, (queue_size_t)ptThread->wPayload);
+        uint64_t dwT1 = __bench_now();
+        if (0 == hwDone) {
+            sched_yield();  // Empty or busy, let the other side run
+            continue;
+        }
+        __bench_samples_add(&ptThread->tSamples, dwT1 - dwT0);
+        __atomic_fetch_add(&s_dwConsumed, hwDone, __ATOMIC_RELAXED);
+    }
+    free(pchData);
+    return NULL;
+}
+
+static void __bench_merge(bench_samples_t *ptTarget, bench_thread_t *ptThreads, uint32_t wCount)
+{
+    uint32_t wTotal = 0;
+    for (uint32_t i = 0; i < wCount; i++) {
+        wTotal += ptThreads[i].tSamples.wCount;
+    }
+    __bench_samples_init(ptTarget, wTotal ? wTotal : 1);
+    for (uint32_t i = 0; i < wCount; i++) {
+        memcpy(&ptTarget->pwSample[ptTarget->wCount], ptThreads[i].tSamples.pwSample,
+               sizeof(uint32_t) * ptThreads[i].tSamples.wCount);
+        ptTarget->wCount += ptThreads[i].tSamples.wCount;
+        free(ptThreads[i].tSamples.pwSample);
+    }
+}
+
+static void __bench_threads(bench_mode_t tMode, bool bWrap, uint32_t wPayload,
+                            uint32_t wProducers, uint32_t wConsumers)
+{
+    const char *pchPattern = bWrap ? "wrap" : "aligned";
+    char chThreads[16];
+    snprintf(chThreads, sizeof(chThreads), "%" PRIu32 ":%" PRIu32, wProducers, wConsumers);
+    uint32_t wSize = __bench_queue_size(wPayload * 2, 65536);
+    uint8_t *pchBuffer = aligned_alloc(64, wSize);
+    uint8_t *pchData = malloc(wPayload);
+    memset(pchBuffer, 0, wSize);
+    byte_queue_t tQueue;
+    __bench_queue_init(&tQueue, pchBuffer, wSize, tMode);
+    __bench_apply_pattern(&tQueue, pchData, wPayload, bWrap);
+
+    uint64_t dwPerProducer = (s_dwBudget / 2) / wProducers;
+    dwPerProducer -= dwPerProducer % wPayload;
+    if (dwPerProducer < (uint64_t)wPayload * BENCH_MIN_CYCLES / wProducers) {
+        dwPerProducer = (uint64_t)wPayload * BENCH_MIN_CYCLES / wProducers;
+    }
+    uint32_t wSampleCap = (uint32_t)(dwPerProducer * wProducers / wPayload + 1);
+    if (wSampleCap > (1u << 20)) {
+        wSampleCap = 1u << 20;
+    }
+    s_dwTotalBytes = dwPerProducer * wProducers;
+    s_dwConsumed = 0;
+
+    bench_thread_t tProducer[wProducers];
+    bench_thread_t tConsumer[wConsumers];
+    uint64_t dwStart = __bench_now();
+    for (uint32_t i = 0; i < wConsumers; i++) {
+        tConsumer[i].ptQueue = &tQueue;
+        tConsumer[i].wPayload = wPayload;
+        __bench_samples_init(&tConsumer[i].tSamples, wSampleCap);
+        pthread_create(&tConsumer[i].tThread, NULL, __bench_consumer, &tConsumer[i]);
+    }
+    for (uint32_t i = 0; i < wProducers; i++) {
+        tProducer[i].ptQueue = &tQueue;
+        tProducer[i].wPayload = wPayload;
+        tProducer[i].dwBytes = dwPerProducer;
+        __bench_samples_init(&tProducer[i].tSamples, wSampleCap);
+        pthread_create(&tProducer[i].tThread, NULL, __bench_producer, &tProducer[i]);
+    }
+    for (uint32_t i = 0; i < wProducers; i++) {
+        pthread_join(tProducer[i].tThread, NULL);
+    }
+    for (uint32_t i = 0; i < wConsumers; i++) {
+        pthread_join(tConsumer[i].tThread, NULL);
+    }
+    uint64_t dwElapsed = __bench_now() - dwStart;
+
+    uint64_t dwEnqueues = 0, dwDequeues = 0;
+    for (uint32_t i = 0; i < wProducers; i++) {
+        dwEnqueues += tProducer[i].tSamples.wCount;
+    }
+    for (uint32_t i = 0; i < wConsumers; i++) {
+        dwDequeues += tConsumer[i].tSamples.wCount;
+    }
+    bench_samples_t tSamples;
+    __bench_merge(&tSamples, tProducer, wProducers);
+    __bench_report("threads", tMode, pchPattern, wPayload, chThreads, "enqueue",
+                   dwEnqueues, s_dwTotalBytes, dwElapsed, &tSamples);
+    free(tSamples.pwSample);
+    __bench_merge(&tSamples, tConsumer, wConsumers);
+    __bench_report("threads", tMode, pchPattern, wPayload, chThreads, "dequeue",
+                   dwDequeues, s_dwTotalBytes, dwElapsed, &tSamples);
+    free(tSamples.pwSample);
+    free(pchData);
+    free(pchBuffer);
+}
+
+/* log text through an lz_queue_t, enqueue and dequeue timed as phases */
+static void __bench_lz(bench_mode_t tMode, uint32_t wBlock)
+{
+    enum { TEXT_SIZE = 64 * 1024, CHUNK = 256 };
+    uint32_t wSize = __bench_queue_size(LZ_QUEUE_BOUND(wBlock) + 64, 16384);
+    uint8_t *pchBuffer = aligned_alloc(64, wSize);
+    void *pWork = aligned_alloc(64, (LZ_QUEUE_WORK_SIZE(wBlock) + 63) & ~(size_t)63);
+    char *pchText = malloc(TEXT_SIZE + 128);
+    uint8_t chOut[CHUNK];
+    byte_queue_t tQueue;
+    lz_queue_t tStream;
+    uint32_t wText = 0;
+    for (uint32_t i = 0; wText < TEXT_SIZE; i++) {
+        wText += (uint32_t)snprintf(&pchText[wText], 128,
+                     "2026-10-17T12:%02u:%02u.%06u INFO sensor[%u] temp=%u.%uC vbat=%umV seq=%u\n",
+                     (i / 600) % 60, (i / 10) % 60, (i * 7919u) % 1000000u, i % 8,
+                     20 + i % 7, i % 10, 3300 - i % 50, i);
+    }
+    __bench_queue_init(&tQueue, pchBuffer, wSize, tMode);
+    if (NULL == lz_queue_init(&tStream, &tQueue, pWork, (queue_size_t)wBlock)) {
+        fprintf(stderr, "lz_queue init failed: block %" PRIu32 "\n", wBlock);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t dwEnqueued = 0, dwDequeued = 0, dwEnqueueNs = 0, dwDequeueNs = 0;
+    uint32_t wPos = 0;
+    while (dwEnqueued < s_dwBudget) {
+        uint64_t dwStart = __bench_now();
+        for (;;) {
+            queue_size_t hwLength = CHUNK;
+            if (wPos + hwLength > TEXT_SIZE) {
+                wPos = 0;
+            }
+            hwLength = lz_enqueue_bytes(&tStream, &pchText[wPos], hwLength);
+            wPos += hwLength;
+            dwEnqueued += hwLength;
+            if (hwLength < CHUNK) {
+                break;
+            }
+        }
+        dwEnqueueNs += __bench_now() - dwStart;
+        dwStart = __bench_now();
+        queue_size_t hwLength;
+        do {
+            hwLength = lz_dequeue_bytes(&tStream, chOut, sizeof(chOut));
+            dwDequeued += hwLength;
+        } while (0 != hwLength);
+        dwDequeueNs += __bench_now() - dwStart;
+    }
+    if (dwDequeued + get_lz_queue_count(&tStream) != dwEnqueued) {
+        fprintf(stderr, "lz: lost data\n");
+    }
+    __bench_report("lz", tMode, "aligned", wBlock, "1:1", "enqueue",
+                   dwEnqueued / CHUNK, dwEnqueued, dwEnqueueNs, NULL);
+    __bench_report("lz", tMode, "aligned", wBlock, "1:1", "dequeue",
+                   dwDequeued / CHUNK, dwDequeued, dwDequeueNs, NULL);
+    free(pchText);
+    free(pWork);
+    free(pchBuffer);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        uint64_t dwMiB = strtoull(argv[1], NULL, 0);
+        if (dwMiB > 0) {
+            s_dwBudget = dwMiB << 20;
+        }
+    }
+    for (uint32_t p = 0; p < sizeof(c_wPayload) / sizeof(c_wPayload[0]); p++) {
+        if (!__bench_payload_fits(c_wPayload[p])) {
+            continue;
+        }
+        for (int nWrap = 0; nWrap < 2; nWrap++) {
+            __bench_single(BENCH_LOCKED, nWrap, c_wPayload[p]);
+            __bench_single(BENCH_COVER, nWrap, c_wPayload[p]);
+            __bench_single(BENCH_SPSC, nWrap, c_wPayload[p]);
+        }
+    }
+    __bench_items(BENCH_TYPED);
+    __bench_items(BENCH_SPSC);
+    __bench_items(BENCH_LOCKED);
+    for (uint32_t p = 2; p < 6; p++) {
+        __bench_lines(BENCH_SPSC, c_wPayload[p], false);
+        __bench_lines(BENCH_SPSC, c_wPayload[p], true);
+        __bench_lines(BENCH_LOCKED, c_wPayload[p], false);
+        __bench_lines(BENCH_LOCKED, c_wPayload[p], true);
+    }
+    for (uint32_t p = 4; p < 7 && __bench_payload_fits(c_wPayload[p]); p++) {
+        __bench_lz(BENCH_SPSC, c_wPayload[p]);
+    }
+    for (uint32_t p = 0; p < sizeof(c_wPayload) / sizeof(c_wPayload[0]); p++) {
+        if (!__bench_payload_fits(c_wPayload[p])) {
+            continue;
+        }
+        for (int nWrap = 0; nWrap < 2; nWrap++) {
+            __bench_threads(BENCH_SPSC, nWrap, c_wPayload[p], 1, 1);
+            __bench_threads(BENCH_LOCKED, nWrap, c_wPayload[p], 1, 1);
+            __bench_threads(BENCH_LOCKED, nWrap, c_wPayload[p], 2, 2);
+            __bench_threads(BENCH_LOCKED, nWrap, c_wPayload[p], 4, 4);
+        }
+    }
+    return 0;
+}
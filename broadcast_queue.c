@@ -0,0 +1,296 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "broadcast_queue.h"
+#undef this
+#define this        (*ptThis)
+
+#define BROADCAST_READER_FREE       0
+#define BROADCAST_READER_ATTACHING  1
+#define BROADCAST_READER_ACTIVE     2
+
+/****************************************************************************
+* Function: broadcast_queue_init                                          *
+* Description: Initializes a broadcast queue object.                      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the broadcast_queue_t object to be initialized.  *
+*   - pBuffer: Pointer to the ring buffer.                                *
+*   - wSize: Size of the buffer in bytes, must be a power of two.         *
+*   - ptReaders: Storage for the reader cursors.                          *
+*   - hwReaderCount: Number of reader cursors.                            *
+*   - tPolicy: What the writer does with lagging readers.                 *
+* Returns: Pointer to the initialized broadcast_queue_t object or NULL.  *
+****************************************************************************/
+broadcast_queue_t *broadcast_queue_init(broadcast_queue_t *ptObj, void *pBuffer, uint32_t wSize,
+                                        broadcast_reader_t *ptReaders, uint16_t hwReaderCount,
+                                        broadcast_policy_t tPolicy)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    broadcast_queue_t *ptThis = (broadcast_queue_t *)ptObj;
+
+    if (pBuffer == NULL || ptReaders == NULL || hwReaderCount == 0
+    ||  wSize == 0 || 0 != (wSize & (wSize - 1))) {
+        return NULL;
+    }
+
+    this.pchBuffer = pBuffer;
+    this.wMask = wSize - 1;
+    this.ptReaders = ptReaders;
+    this.hwReaderCount = hwReaderCount;
+    this.tPolicy = tPolicy;
+    for (uint16_t i = 0; i < hwReaderCount; i++) {
+        ptReaders[i].wHead = 0;
+        ptReaders[i].wLost = 0;
+        ptReaders[i].chState = BROADCAST_READER_FREE;
+    }
+    this.wTail = 0;
+    this.wHeadCache = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: broadcast_queue_attach                                        *
+* Description: Claims a free reader cursor and points it at the current   *
+*              end of the stream.                                         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the broadcast_queue_t object.                    *
+* Returns: Pointer to the reader cursor, or NULL if none is free.        *
+****************************************************************************/
+broadcast_reader_t *broadcast_queue_attach(broadcast_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    broadcast_queue_t *ptThis = (broadcast_queue_t *)ptObj;
+
+    for (uint16_t i = 0; i < this.hwReaderCount; i++) {
+        broadcast_reader_t *ptReader = &this.ptReaders[i];
+        uint8_t chState = BROADCAST_READER_FREE;
+        if (!__atomic_compare_exchange_n(&ptReader->chState, &chState, BROADCAST_READER_ATTACHING,
+                                         false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;  // Taken by another reader
+        }
+        uint32_t wStart = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&ptReader->wHead, wStart, __ATOMIC_RELAXED);
+        __atomic_store_n(&ptReader->wLost, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&ptReader->chState, BROADCAST_READER_ACTIVE, __ATOMIC_RELEASE);
+        /* Pairs with the fence in __broadcast_scan(): a writer that did not
+         * see this reader yet has not published anything past wTail as read
+         * below, and only overwrites bytes older than what it had seen. */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        uint32_t wNow = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE);
+        while ((int32_t)(wNow - wStart) > 0) {  // Skip what was written meanwhile
+            if (__atomic_compare_exchange_n(&ptReader->wHead, &wStart, wNow, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        return ptReader;
+    }
+    return NULL;
+}
+
+/****************************************************************************
+* Function: broadcast_queue_detach                                        *
+* Description: Releases a reader cursor.                                  *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the broadcast_queue_t object.                    *
+*   - ptReader: Cursor returned by broadcast_queue_attach().              *
+* Returns: True if the cursor was attached, false otherwise.             *
+****************************************************************************/
+bool broadcast_queue_detach(broadcast_queue_t *ptObj, broadcast_reader_t *ptReader)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    broadcast_queue_t *ptThis = (broadcast_queue_t *)ptObj;
+
+    if (NULL == ptReader || ptReader < this.ptReaders
+    ||  ptReader >= &this.ptReaders[this.hwReaderCount]) {
+        return false;
+    }
+    uint8_t chState = BROADCAST_READER_ACTIVE;
+    return __atomic_compare_exchange_n(&ptReader->chState, &chState, BROADCAST_READER_FREE,
+                                       false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/****************************************************************************
+* Function: __broadcast_scan                                              *
+* Description: Writer side: finds the slowest attached reader. Under      *
+*              DROP_SLOWEST every reader behind wNeeded is first pushed   *
+*              to wNeeded, and the skipped bytes are added to its wLost.  *
+* Returns: The slowest cursor, wTail if no reader is attached.            *
+****************************************************************************/
+static uint32_t __broadcast_scan(broadcast_queue_t *ptThis, uint32_t wTail, uint32_t wNeeded)
+{
+    uint32_t wSlowest = wTail;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);  // Order the last wTail before the state loads
+    for (uint16_t i = 0; i < this.hwReaderCount; i++) {
+        broadcast_reader_t *ptReader = &this.ptReaders[i];
+        if (BROADCAST_READER_ACTIVE != __atomic_load_n(&ptReader->chState, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        uint32_t wHead = __atomic_load_n(&ptReader->wHead, __ATOMIC_ACQUIRE);
+        if (BROADCAST_DROP_SLOWEST == this.tPolicy) {
+            while ((int32_t)(wNeeded - wHead) > 0) {  // The reader holds bytes about to be overwritten
+                if (__atomic_compare_exchange_n(&ptReader->wHead, &wHead, wNeeded, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    __atomic_fetch_add(&ptReader->wLost, wNeeded - wHead, __ATOMIC_RELAXED);
+                    wHead = wNeeded;
+                }
+            }
+        }
+        if ((int32_t)(wSlowest - wHead) > 0) {
+            wSlowest = wHead;
+        }
+    }
+    return wSlowest;
+}
+
+/****************************************************************************
+* Function: broadcast_enqueue_bytes                                       *
+* Description: Appends bytes to the stream, writer side.                  *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the broadcast_queue_t object.                    *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - wDataLength: Number of bytes to enqueue.                            *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+uint32_t broadcast_enqueue_bytes(broadcast_queue_t *ptObj, const void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    broadcast_queue_t *ptThis = (broadcast_queue_t *)ptObj;
+    const uint8_t *pchByte = pDate;
+    uint32_t wSize = this.wMask + 1;
+    uint32_t wTail = this.wTail;  // Owned by the writer
+    if (wDataLength > wSize) {  // If data length exceeds queue size
+        wDataLength = wSize;  // Limit data length to queue size
+    }
+    if (wDataLength > wSize - (wTail - this.wHeadCache)) {  // Full as far as the writer knows
+        this.wHeadCache = __broadcast_scan(ptThis, wTail, wTail + wDataLength - wSize);
+        uint32_t wFree = wSize - (wTail - this.wHeadCache);
+        if (wDataLength > wFree) {  // Only left under WAIT_SLOWEST
+            wDataLength = wFree;  // Adjust data length
+        }
+    }
+    if (0 == wDataLength) {
+        return 0;
+    }
+    uint32_t wIndex = wTail & this.wMask;
+    uint32_t wFirst = wSize - wIndex;
+    if (wDataLength <= wFirst) {
+        memcpy(&this.pchBuffer[wIndex], pchByte, wDataLength);  // Copy data to buffer
+    } else {
+        memcpy(&this.pchBuffer[wIndex], &pchByte[0], wFirst);  // Copy first part
+        memcpy(&this.pchBuffer[0], &pchByte[wFirst], wDataLength - wFirst);  // Copy second part
+    }
+    __atomic_store_n(&this.wTail, wTail + wDataLength, __ATOMIC_RELEASE);  // Publish the data
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: broadcast_dequeue_bytes                                       *
+* Description: Reads bytes through one reader's cursor. The cursor is     *
+*              committed with a CAS: if the writer moved it meanwhile the *
+*              copied bytes may be overwritten, so the read starts over   *
+*              from where the writer left the cursor.                     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the broadcast_queue_t object.                    *
+*   - ptReader: Cursor returned by broadcast_queue_attach().              *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - wDataLength: Number of bytes to dequeue.                            *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+uint32_t broadcast_dequeue_bytes(broadcast_queue_t *ptObj, broadcast_reader_t *ptReader,
+                                 void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != ptReader);  // Ensure ptReader is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    broadcast_queue_t *ptThis = (broadcast_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;
+    uint32_t wSize = this.wMask + 1;
+    uint32_t wHead = __atomic_load_n(&ptReader->wHead, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t wTail = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE);
+        uint32_t wLength = wTail - wHead;
+        if (wLength > wSize) {  // The writer moved the cursor after it was loaded
+            wHead = __atomic_load_n(&ptReader->wHead, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        if (wLength > wDataLength) {  // If requested length exceeds available data
+            wLength = wDataLength;  // Adjust data length
+        }
+        if (0 == wLength) {
+            return 0;
+        }
+        uint32_t wIndex = wHead & this.wMask;
+        uint32_t wFirst = wSize - wIndex;
+        if (wLength <= wFirst) {
+            memcpy(pchByte, &this.pchBuffer[wIndex], wLength);  // Copy data from buffer
+        } else {
+            memcpy(&pchByte[0], &this.pchBuffer[wIndex], wFirst);  // Copy first part
+            memcpy(&pchByte[wFirst], &this.pchBuffer[0], wLength - wFirst);  // Copy second part
+        }
+        if (BROADCAST_DROP_SLOWEST != this.tPolicy) {
+            __atomic_store_n(&ptReader->wHead, wHead + wLength, __ATOMIC_RELEASE);  // Hand the space back
+            return wLength;
+        }
+        if (__atomic_compare_exchange_n(&ptReader->wHead, &wHead, wHead + wLength, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+            return wLength;
+        }
+        /* overrun while copying: wHead now holds the writer's new cursor */
+    }
+}
+
+/****************************************************************************
+* Function: get_broadcast_queue_count                                     *
+* Description: Gets the number of bytes a reader has not read yet.        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the broadcast_queue_t object.                    *
+*   - ptReader: Cursor returned by broadcast_queue_attach().              *
+* Returns: Number of unread bytes.                                        *
+****************************************************************************/
+uint32_t get_broadcast_queue_count(broadcast_queue_t *ptObj, broadcast_reader_t *ptReader)
+{
+    assert(NULL != ptObj);
+    assert(NULL != ptReader);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    broadcast_queue_t *ptThis = (broadcast_queue_t *)ptObj;
+    uint32_t wHead = __atomic_load_n(&ptReader->wHead, __ATOMIC_ACQUIRE);
+    uint32_t wTail = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE);
+    if (wTail - wHead > this.wMask + 1) {  // wHead was read before both sides moved on
+        return this.wMask + 1;
+    }
+    return wTail - wHead;
+}
+
+/****************************************************************************
+* Function: get_broadcast_reader_lost                                     *
+* Description: Takes the number of bytes the writer skipped for a reader. *
+* Parameters:                                                             *
+*   - ptReader: Cursor returned by broadcast_queue_attach().              *
+* Returns: Bytes lost since the last call.                                *
+****************************************************************************/
+uint32_t get_broadcast_reader_lost(broadcast_reader_t *ptReader)
+{
+    assert(NULL != ptReader);
+    return __atomic_exchange_n(&ptReader->wLost, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,148 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_BROADCAST_QUEUE_H_
+#define QUEUE_BROADCAST_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief What the writer does when the slowest reader has not yet freed the
+ *        space it needs.
+ */
+typedef enum {
+    BROADCAST_WAIT_SLOWEST = 0,     /* store only what fits, like enqueue_bytes() */
+    BROADCAST_DROP_SLOWEST,         /* push lagging readers forward, they lose data */
+} broadcast_policy_t;
+
+/*!
+ * \brief Cursor of one reader. Each one sits on its own cache line.
+ */
+typedef struct broadcast_reader_t {
+    __QUEUE_CACHE_ALIGNED uint32_t wHead;   /* moved by the reader, and by the
+                                             * writer under DROP_SLOWEST */
+    uint32_t wLost;                         /* bytes skipped by the writer */
+    uint8_t chState;
+} broadcast_reader_t;
+
+/*!
+ * \brief One-writer/many-reader byte queue: every attached reader sees every
+ *        byte written after it attached, through its own cursor.
+ *
+ * \details The data is stored once. Space is only reused when the slowest
+ *          reader has read past it. Under BROADCAST_DROP_SLOWEST the writer
+ *          instead moves a lagging reader's cursor forward with a CAS and
+ *          counts the skipped bytes in its wLost. A reader commits its
+ *          cursor with a CAS too, so a read that raced with the overwrite is
+ *          thrown away and retried instead of returning torn data.
+ *
+ *          The writer keeps the slowest cursor it last saw and only scans the
+ *          readers again when that view says the queue is full. Readers may
+ *          attach and detach at any time. The buffer size must be a power of
+ *          two; the core needs 32-bit CAS support, like mpmc_queue_t.
+ */
+typedef struct broadcast_queue_t {
+    uint8_t *pchBuffer;
+    uint32_t wMask;
+    broadcast_reader_t *ptReaders;
+    uint16_t hwReaderCount;
+    broadcast_policy_t tPolicy;
+    __QUEUE_CACHE_ALIGNED uint32_t wTail;  /* written by the writer */
+    uint32_t wHeadCache;                    /* writer's view of the slowest reader */
+} broadcast_queue_t;
+
+/*!
+ * \brief Initialize the broadcast queue object.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pBuffer address of the ring buffer.
+ * \param[in] wSize size of the ring buffer in bytes, must be a power of two.
+ * \param[in] ptReaders storage for hwReaderCount reader cursors.
+ * \param[in] hwReaderCount largest number of readers attached at once.
+ * \param[in] tPolicy what to do with a reader that falls a whole buffer behind.
+ *
+ * \return the address of queue item, or NULL on a bad parameter.
+ *
+ * \details Here is an example:
+    E.g.
+    \code
+        static uint8_t s_chBuffer[4096];
+        static broadcast_reader_t s_tReaders[3];
+        static broadcast_queue_t s_tStream;
+        broadcast_queue_init(&s_tStream, s_chBuffer, sizeof(s_chBuffer),
+                             s_tReaders, 3, BROADCAST_DROP_SLOWEST);
+
+        broadcast_reader_t *ptLogger = broadcast_queue_attach(&s_tStream);
+        broadcast_enqueue_bytes(&s_tStream, chSample, sizeof(chSample));
+        broadcast_dequeue_bytes(&s_tStream, ptLogger, chOut, sizeof(chOut));
+    \endcode
+ */
+extern
+broadcast_queue_t *broadcast_queue_init(broadcast_queue_t *ptObj, void *pBuffer, uint32_t wSize,
+                                        broadcast_reader_t *ptReaders, uint16_t hwReaderCount,
+                                        broadcast_policy_t tPolicy);
+
+/*!
+ * \brief Register a reader. It starts at the current end of the stream.
+ *
+ * \return the reader's cursor, or NULL if all of them are taken.
+ */
+extern
+broadcast_reader_t *broadcast_queue_attach(broadcast_queue_t *ptObj);
+
+/*!
+ * \brief Unregister a reader, so it no longer holds back the writer.
+ */
+extern
+bool broadcast_queue_detach(broadcast_queue_t *ptObj, broadcast_reader_t *ptReader);
+
+/*!
+ * \brief Append bytes to the stream. Only one context may write.
+ *
+ * \return the number of bytes stored: all of them under DROP_SLOWEST (up to
+ *         the buffer size), what the slowest reader left room for otherwise.
+ */
+extern
+uint32_t broadcast_enqueue_bytes(broadcast_queue_t *ptObj, const void *pDate, uint32_t wDataLength);
+
+/*!
+ * \brief Read bytes through one reader's cursor. Each reader must only be
+ *        used by one context.
+ *
+ * \return the number of bytes read.
+ */
+extern
+uint32_t broadcast_dequeue_bytes(broadcast_queue_t *ptObj, broadcast_reader_t *ptReader,
+                                 void *pDate, uint32_t wDataLength);
+
+extern
+uint32_t get_broadcast_queue_count(broadcast_queue_t *ptObj, broadcast_reader_t *ptReader);
+
+/*!
+ * \brief Number of bytes this reader lost to BROADCAST_DROP_SLOWEST since the
+ *        last call; reading clears it.
+ */
+extern
+uint32_t get_broadcast_reader_lost(broadcast_reader_t *ptReader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_BROADCAST_QUEUE_H_ */
@@ -15,9 +15,144 @@
 *                                                                           *
 ****************************************************************************/
 #include "byte_queue.h"
+#if QUEUE_CFG_USE_FUTEX
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#if QUEUE_CFG_USE_MIRROR
+#include <unistd.h>
+#include <linux/memfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#if QUEUE_CFG_USE_EVENTFD
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#endif
+#if QUEUE_CFG_STATS && QUEUE_CFG_STATS_HISTOGRAM && !defined(QUEUE_CFG_STATS_CLOCK)
+#include <time.h>
+#endif
 #undef this
 #define this        (*ptThis)
 
+#ifdef __QUEUE_HOST_ATOM
+pthread_mutex_t g_tQueueAtomMutex = PTHREAD_MUTEX_INITIALIZER;
+__thread uint32_t g_wQueueAtomDepth = 0;
+#endif
+
+/* The SPSC mode only shares the free-running counters between the two sides.
+ * These follow the C11 memory model: the producer publishes hwTailCount with
+ * release semantics after the data is copied in, the consumer publishes
+ * hwHeadCount with release semantics after the data is copied out, and each
+ * side reads the other's counter with acquire semantics.
+ */
+#define __queue_load_acquire(__PTR)                                            \
+    __atomic_load_n((__PTR), __ATOMIC_ACQUIRE)
+
+#define __queue_store_release(__PTR, __VALUE)                                  \
+    __atomic_store_n((__PTR), (__VALUE), __ATOMIC_RELEASE)
+
+#if QUEUE_CFG_USE_FUTEX
+/****************************************************************************
+* Function: __queue_wake                                                  *
+* Description: Wakes the threads parked on a futex word. The caller has   *
+*              already published its change, the fence orders that before *
+*              the waiter check so a thread that registers concurrently   *
+*              either sees the change or gets woken. Without a waiter     *
+*              this costs no syscall.                                     *
+****************************************************************************/
+static void __queue_wake(uint32_t *pwEvent, uint32_t *pwWaiters)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(0 != __atomic_load_n(pwWaiters, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(pwEvent, 1, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, pwEvent, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+#endif
+
+#if QUEUE_CFG_USE_EVENTFD
+/****************************************************************************
+* Function: __queue_signal                                                *
+* Description: Writes the eventfd of an armed side and disarms it, so     *
+*              only the first of many notifications reaches the kernel.   *
+*              The fence orders the caller's published counters before   *
+*              the check of the flag, against the fence in the re-arm     *
+*              calls, so a side that arms concurrently either sees the    *
+*              change or gets signalled.                                  *
+****************************************************************************/
+static void __queue_signal(bool *pbArmed, int nFd)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(pbArmed, __ATOMIC_RELAXED)
+    && __atomic_exchange_n(pbArmed, false, __ATOMIC_RELAXED)) {
+        uint64_t dwOne = 1;
+        while(write(nFd, &dwOne, sizeof(dwOne)) < 0 && EINTR == errno) {
+        }
+    }
+}
+#endif
+
+#if QUEUE_CFG_USE_FUTEX || QUEUE_CFG_USE_EVENTFD
+/****************************************************************************
+* Function: __queue_readable                                              *
+* Description: Tells waiting consumers that data was added.               *
+****************************************************************************/
+static void __queue_readable(byte_queue_t *ptThis)
+{
+#if QUEUE_CFG_USE_FUTEX
+    __queue_wake(&this.wReadEvent, &this.wReadWaiters);
+#endif
+#if QUEUE_CFG_USE_EVENTFD
+    if(this.nReadEventFd >= 0) {
+        __queue_signal(&this.bReadArmed, this.nReadEventFd);
+    }
+#endif
+}
+
+/****************************************************************************
+* Function: __queue_writable                                              *
+* Description: Tells waiting producers that space was freed. The eventfd  *
+*              is only written once hwWriteThreshold bytes are free.      *
+****************************************************************************/
+static void __queue_writable(byte_queue_t *ptThis)
+{
+#if QUEUE_CFG_USE_FUTEX
+    __queue_wake(&this.wWriteEvent, &this.wWriteWaiters);
+#endif
+#if QUEUE_CFG_USE_EVENTFD
+    if(this.nWriteEventFd >= 0 && get_queue_available_count(ptThis) >= this.hwWriteThreshold) {
+        __queue_signal(&this.bWriteArmed, this.nWriteEventFd);
+    }
+#endif
+}
+
+/* data was added, wake blocked consumers */
+#define __queue_notify_readers(__PTR, __COUNT)                                 \
+    do {                                                                       \
+        if((__COUNT) > 0) {                                                    \
+            __queue_readable(__PTR);                                           \
+        }                                                                      \
+    } while(0)
+
+/* space was freed, wake blocked producers */
+#define __queue_notify_writers(__PTR, __COUNT)                                 \
+    do {                                                                       \
+        if((__COUNT) > 0) {                                                    \
+            __queue_writable(__PTR);                                           \
+        }                                                                      \
+    } while(0)
+#else
+#define __queue_notify_readers(__PTR, __COUNT)
+#define __queue_notify_writers(__PTR, __COUNT)
+#endif
+
 /****************************************************************************
 * Function: queue_init_byte                                               *
 * Description: Initializes a byte queue object.                           *
@@ -28,7 +163,7 @@
 *   - bIsCover: Indicates whether the queue should overwrite when full.  *
 * Returns: Pointer to the initialized byte_queue_t object or NULL.       *
 ****************************************************************************/
-byte_queue_t *queue_init_byte(byte_queue_t *ptObj, void *pBuffer, uint16_t hwItemSize, bool bIsCover)
+byte_queue_t *queue_init_byte(byte_queue_t *ptObj, void *pBuffer, queue_size_t hwItemSize, bool bIsCover)
 {
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
@@ -46,11 +181,260 @@ byte_queue_t *queue_init_byte(byte_queue_t *ptObj, void *pBuffer, uint16_t hwIte
         this.hwLength = 0;
         this.hwPeek = this.hwHead;
         this.hwPeekLength = 0;
+        this.hwHeadCount = 0;
+        this.hwTailCount = 0;
+        this.hwPeekCount = 0;
+        this.hwHeadCache = 0;
+        this.hwTailCache = 0;
+        this.bMutex = false;
         this.bIsCover = bIsCover;
+        this.bIsSPSC = false;
+        this.bIsPow2 = (0 == (hwItemSize & (hwItemSize - 1)));
+        this.bIsMessage = false;
+#if QUEUE_CFG_USE_MIRROR
+        this.bIsMirror = false;
+#endif
+#if QUEUE_CFG_USE_FUTEX
+        this.wReadEvent = 0;
+        this.wWriteEvent = 0;
+        this.wReadWaiters = 0;
+        this.wWriteWaiters = 0;
+#endif
+#if QUEUE_CFG_USE_EVENTFD
+        this.nReadEventFd = -1;
+        this.nWriteEventFd = -1;
+        this.bReadArmed = false;
+        this.bWriteArmed = false;
+#endif
+#if QUEUE_CFG_STATS
+        memset(&this.tStats, 0, sizeof(this.tStats));
+#endif
+    }
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: queue_init_spsc                                               *
+* Description: Initializes a lock-free single-producer/single-consumer    *
+*              byte queue object.                                         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object to be initialized.       *
+*   - pBuffer: Pointer to the buffer for storing data.                    *
+*   - hwItemSize: Size of the buffer in bytes.                            *
+* Returns: Pointer to the initialized byte_queue_t object or NULL.       *
+****************************************************************************/
+byte_queue_t *queue_init_spsc(byte_queue_t *ptObj, void *pBuffer, queue_size_t hwItemSize)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+
+    if (pBuffer == NULL || hwItemSize == 0) {
+        return NULL;
     }
+
+    /* neither side may be running yet, so plain stores are enough */
+    this.pchBuffer = pBuffer;
+    this.hwSize = hwItemSize;
+    this.hwHead = 0;
+    this.hwTail = 0;
+    this.hwLength = 0;
+    this.hwPeek = 0;
+    this.hwPeekLength = 0;
+    this.hwHeadCount = 0;
+    this.hwTailCount = 0;
+    this.hwPeekCount = 0;
+    this.hwHeadCache = 0;
+    this.hwTailCache = 0;
+    this.bMutex = false;
+    this.bIsCover = false;
+    this.bIsSPSC = true;
+    this.bIsPow2 = (0 == (hwItemSize & (hwItemSize - 1)));
+    this.bIsMessage = false;
+#if QUEUE_CFG_USE_MIRROR
+    this.bIsMirror = false;
+#endif
+#if QUEUE_CFG_USE_FUTEX
+    this.wReadEvent = 0;
+    this.wWriteEvent = 0;
+    this.wReadWaiters = 0;
+    this.wWriteWaiters = 0;
+#endif
+#if QUEUE_CFG_USE_EVENTFD
+    this.nReadEventFd = -1;
+    this.nWriteEventFd = -1;
+    this.bReadArmed = false;
+    this.bWriteArmed = false;
+#endif
+#if QUEUE_CFG_STATS
+    memset(&this.tStats, 0, sizeof(this.tStats));
+#endif
+    __atomic_thread_fence(__ATOMIC_RELEASE);
     return ptObj;
 }
 
+/****************************************************************************
+* Function: __queue_is_counted                                            *
+* Description: Tells whether the queue runs on the free-running counters  *
+*              (SPSC or power-of-two mode) instead of hwLength.           *
+****************************************************************************/
+static inline bool __queue_is_counted(byte_queue_t *ptThis)
+{
+    return this.bIsSPSC || this.bIsPow2;
+}
+
+#if QUEUE_CFG_STATS
+/* Most counters are only written by the side that owns the queue (the bMutex
+ * holder, or the SPSC producer/consumer), so a relaxed load and store is
+ * enough. Truncations are counted by the producer of the counter based modes,
+ * or inside the safe_atom_code() blocks of the locked mode. Busy rejects are
+ * counted by callers that do not own the queue and are added up inside
+ * safe_atom_code().
+ */
+#define __queue_stats_add(__PTR, __FIELD, __VALUE)                             \
+    __atomic_store_n(&(__PTR)->tStats.__FIELD,                                 \
+        __atomic_load_n(&(__PTR)->tStats.__FIELD, __ATOMIC_RELAXED) + (__VALUE),\
+        __ATOMIC_RELAXED)
+
+#define __queue_stats_count(__PTR, __FIELD, __VALUE)                           \
+    safe_atom_code() {                                                         \
+        __queue_stats_add(__PTR, __FIELD, __VALUE);                            \
+    }
+
+#define __queue_stats_overwritten(__PTR, __COUNT)                              \
+    __queue_stats_add(__PTR, dwOverwrittenBytes, __COUNT)
+
+#define __queue_stats_truncated(__PTR, __COUNT)                                \
+    __queue_stats_add(__PTR, dwTruncatedBytes, __COUNT)
+
+#define __queue_stats_busy(__PTR)                                              \
+    __queue_stats_count(__PTR, dwBusyRejects, 1)
+
+#if QUEUE_CFG_STATS_HISTOGRAM
+#ifndef QUEUE_CFG_STATS_CLOCK
+#if defined(__unix__) || defined(__APPLE__)
+static inline uint32_t __queue_stats_clock(void)
+{
+    struct timespec tNow;
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    return (uint32_t)((uint64_t)tNow.tv_sec * 1000000000u + (uint64_t)tNow.tv_nsec);
+}
+#define QUEUE_CFG_STATS_CLOCK()     __queue_stats_clock()
+#else
+#error "QUEUE_CFG_STATS_HISTOGRAM needs QUEUE_CFG_STATS_CLOCK() on this target"
+#endif
+#endif
+
+#define __queue_stats_start(__NAME)                                            \
+    uint32_t __NAME = QUEUE_CFG_STATS_CLOCK()
+
+/****************************************************************************
+* Function: __queue_stats_latency                                         *
+* Description: Adds the ticks elapsed since wStart to a log2 histogram.   *
+****************************************************************************/
+static void __queue_stats_latency(uint32_t *pwHistogram, uint32_t wStart)
+{
+    uint32_t wTicks = QUEUE_CFG_STATS_CLOCK() - wStart;
+    uint32_t wBucket = (0 == wTicks) ? 0 : 32 - __builtin_clz(wTicks);
+    if(wBucket >= QUEUE_STATS_HISTOGRAM_BUCKETS) {
+        wBucket = QUEUE_STATS_HISTOGRAM_BUCKETS - 1;
+    }
+    __atomic_store_n(&pwHistogram[wBucket],
+                     __atomic_load_n(&pwHistogram[wBucket], __ATOMIC_RELAXED) + 1,
+                     __ATOMIC_RELAXED);
+}
+#else
+#define __queue_stats_start(__NAME)                                            \
+    uint32_t __NAME = 0
+#define __queue_stats_latency(__HISTOGRAM, __START)     ((void)(__START))
+#endif
+
+/****************************************************************************
+* Function: __queue_stats_enqueued                                        *
+* Description: Counts a successful enqueue and tracks the high-water mark.*
+*              Called by the producer while it still owns the queue.      *
+****************************************************************************/
+static void __queue_stats_enqueued(byte_queue_t *ptThis, queue_size_t hwDataLength, uint32_t wStart)
+{
+    if(0 == hwDataLength) {
+        return;
+    }
+    __queue_stats_add(ptThis, dwEnqueueOps, 1);
+    __queue_stats_add(ptThis, dwEnqueueBytes, hwDataLength);
+    queue_size_t hwLength = this.hwLength;
+    if(__queue_is_counted(ptThis)) {
+        hwLength = (queue_size_t)(this.hwTailCount - __atomic_load_n(&this.hwHeadCount, __ATOMIC_RELAXED));
+    }
+    if(hwLength > this.tStats.hwHighWater) {
+        __atomic_store_n(&this.tStats.hwHighWater, hwLength, __ATOMIC_RELAXED);
+    }
+    __queue_stats_latency(this.tStats.wEnqueueLatency, wStart);
+}
+
+/****************************************************************************
+* Function: __queue_stats_dequeued                                        *
+* Description: Counts a successful dequeue. Called by the consumer while  *
+*              it still owns the queue.                                   *
+****************************************************************************/
+static void __queue_stats_dequeued(byte_queue_t *ptThis, queue_size_t hwDataLength, uint32_t wStart)
+{
+    if(0 == hwDataLength) {
+        return;
+    }
+    __queue_stats_add(ptThis, dwDequeueOps, 1);
+    __queue_stats_add(ptThis, dwDequeueBytes, hwDataLength);
+    __queue_stats_latency(this.tStats.wDequeueLatency, wStart);
+}
+#else
+#define __queue_stats_start(__NAME)
+#define __queue_stats_overwritten(__PTR, __COUNT)
+#define __queue_stats_truncated(__PTR, __COUNT)
+#define __queue_stats_busy(__PTR)
+#define __queue_stats_enqueued(__PTR, __COUNT, __START)
+#define __queue_stats_dequeued(__PTR, __COUNT, __START)
+#endif
+
+/****************************************************************************
+* Function: __queue_try_lock                                              *
+* Description: Takes bMutex if it is free.                                *
+* Returns: True if the caller now owns the queue, false otherwise.       *
+****************************************************************************/
+static bool __queue_try_lock(byte_queue_t *ptThis)
+{
+    bool bLocked = false;
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(!this.bMutex) {  // Check if mutex is free
+            this.bMutex  = true;  // Lock the queue for thread safety
+            bLocked = true;
+        } else {
+            __queue_stats_busy(ptThis);
+        }
+    }
+    return bLocked;
+}
+
+/****************************************************************************
+* Function: __queue_enter                                                 *
+* Description: Gains access to a counter based queue. The SPSC mode needs *
+*              no lock, the power-of-two mode takes bMutex.               *
+* Returns: True if the caller may proceed, false if the queue is busy.   *
+****************************************************************************/
+static inline bool __queue_enter(byte_queue_t *ptThis)
+{
+    return this.bIsSPSC || __queue_try_lock(ptThis);
+}
+
+/****************************************************************************
+* Function: __queue_leave                                                 *
+* Description: Counterpart of __queue_enter().                            *
+****************************************************************************/
+static inline void __queue_leave(byte_queue_t *ptThis)
+{
+    if(!this.bIsSPSC) {
+        __queue_store_release(&this.bMutex, false);  // Unlock the queue
+    }
+}
+
 /****************************************************************************
 * Function: reset_queue                                                   *
 * Description: Resets the byte queue to its initial state.                *
@@ -63,6 +447,23 @@ bool reset_queue(byte_queue_t *ptObj)
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (__queue_is_counted(ptThis)) {
+        /* in SPSC mode only legal while neither side is active */
+        if (!__queue_enter(ptThis)) {
+            return false;
+        }
+        this.hwHead = 0;
+        this.hwTail = 0;
+        this.hwPeek = 0;
+        this.hwPeekCount = 0;
+        this.hwHeadCache = 0;
+        this.hwTailCache = 0;
+        __queue_store_release(&this.hwTailCount, 0);
+        __queue_store_release(&this.hwHeadCount, 0);
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, 1);
+        return true;
+    }
     safe_atom_code() {
         this.hwHead = 0;
         this.hwTail = 0;
@@ -70,10 +471,212 @@ bool reset_queue(byte_queue_t *ptObj)
         this.hwPeek = this.hwHead;
         this.hwPeekLength = 0;
     }
+    __queue_notify_writers(ptThis, 1);
     return true;
 }
 
+/****************************************************************************
+* Function: __queue_index                                                 *
+* Description: Maps a free-running counter to its ring buffer index. In   *
+*              power-of-two mode the counter is simply masked, otherwise  *
+*              the side owning the counter keeps the wrapped index.       *
+****************************************************************************/
+static inline queue_size_t __queue_index(byte_queue_t *ptThis, queue_size_t hwCount, queue_size_t hwIndex)
+{
+    if(this.bIsPow2) {
+        return hwCount & (this.hwSize - 1);
+    }
+    return hwIndex;
+}
+
+/****************************************************************************
+* Function: __queue_advance                                               *
+* Description: Moves a ring buffer index forward, wrapping at hwSize.     *
+****************************************************************************/
+static inline queue_size_t __queue_advance(byte_queue_t *ptThis, queue_size_t hwIndex, queue_size_t hwDataLength)
+{
+    if(hwDataLength < (this.hwSize - hwIndex)) {
+        return hwIndex + hwDataLength;
+    }
+    return hwDataLength - (this.hwSize - hwIndex);
+}
+
+/****************************************************************************
+* Function: __queue_copy_in                                               *
+* Description: Copies data into the ring buffer at the given index and    *
+*              returns the index just past the written bytes.             *
+****************************************************************************/
+static queue_size_t __queue_copy_in(byte_queue_t *ptThis, queue_size_t hwIndex, const uint8_t *pchByte, queue_size_t hwDataLength)
+{
+#if QUEUE_CFG_USE_MIRROR
+    if(this.bIsMirror) {  // The second mapping continues the first one
+        memcpy(&this.pchBuffer[hwIndex], pchByte, hwDataLength);
+        return __queue_advance(ptThis, hwIndex, hwDataLength);
+    }
+#endif
+    if(hwDataLength < (this.hwSize - hwIndex)) {
+        memcpy(&this.pchBuffer[hwIndex], pchByte, hwDataLength);
+        return hwIndex + hwDataLength;
+    }
+    memcpy(&this.pchBuffer[hwIndex], &pchByte[0], this.hwSize - hwIndex);  // Copy first part
+    memcpy(&this.pchBuffer[0], &pchByte[this.hwSize - hwIndex], hwDataLength - (this.hwSize - hwIndex));  // Copy second part
+    return hwDataLength - (this.hwSize - hwIndex);
+}
+
+/****************************************************************************
+* Function: __queue_copy_out                                              *
+* Description: Copies data out of the ring buffer from the given index    *
+*              and returns the index just past the read bytes.            *
+****************************************************************************/
+static queue_size_t __queue_copy_out(byte_queue_t *ptThis, queue_size_t hwIndex, uint8_t *pchByte, queue_size_t hwDataLength)
+{
+#if QUEUE_CFG_USE_MIRROR
+    if(this.bIsMirror) {  // The second mapping continues the first one
+        memcpy(pchByte, &this.pchBuffer[hwIndex], hwDataLength);
+        return __queue_advance(ptThis, hwIndex, hwDataLength);
+    }
+#endif
+    if(hwDataLength < (this.hwSize - hwIndex)) {
+        memcpy(pchByte, &this.pchBuffer[hwIndex], hwDataLength);
+        return hwIndex + hwDataLength;
+    }
+    memcpy(&pchByte[0], &this.pchBuffer[hwIndex], this.hwSize - hwIndex);  // Copy first part
+    memcpy(&pchByte[this.hwSize - hwIndex], &this.pchBuffer[0], hwDataLength - (this.hwSize - hwIndex));  // Copy second part
+    return hwDataLength - (this.hwSize - hwIndex);
+}
+
+/****************************************************************************
+* Function: __queue_drop_counted                                          *
+* Description: Cover mode of the counter based modes: discards the oldest *
+*              bytes to make room. Only called with bMutex held, so the   *
+*              consumer's view of hwTailCount may be refreshed as well,   *
+*              it must never fall behind the moved hwHeadCount.           *
+****************************************************************************/
+static void __queue_drop_counted(byte_queue_t *ptThis, queue_size_t hwHeadCount, queue_size_t hwOverLength)
+{
+    if(!this.bIsPow2) {
+        this.hwHead = __queue_advance(ptThis, this.hwHead, hwOverLength);  // Move head forward
+        this.hwPeek = this.hwHead;  // Update peek index
+    }
+    hwHeadCount += hwOverLength;
+    this.hwPeekCount = hwHeadCount;  // Update peek counter
+    this.hwHeadCache = hwHeadCount;
+    this.hwTailCache = this.hwTailCount;
+    __queue_store_release(&this.hwHeadCount, hwHeadCount);
+    __queue_stats_overwritten(ptThis, hwOverLength);
+}
+
+/****************************************************************************
+* Function: __queue_head_count                                            *
+* Description: Producer side view of hwHeadCount. The cached value is     *
+*              used while it leaves room for hwDataLength bytes, only     *
+*              otherwise is the consumer's counter read again.            *
+****************************************************************************/
+static inline queue_size_t __queue_head_count(byte_queue_t *ptThis, queue_size_t hwDataLength)
+{
+    queue_size_t hwFree = this.hwSize - (queue_size_t)(this.hwTailCount - this.hwHeadCache);
+    if(hwDataLength > hwFree) {
+        this.hwHeadCache = __queue_load_acquire(&this.hwHeadCount);
+    }
+    return this.hwHeadCache;
+}
+
+/****************************************************************************
+* Function: __queue_tail_count                                            *
+* Description: Consumer side view of hwTailCount. The cached value is     *
+*              used while it holds hwDataLength bytes past hwCount, only  *
+*              otherwise is the producer's counter read again.            *
+****************************************************************************/
+static inline queue_size_t __queue_tail_count(byte_queue_t *ptThis, queue_size_t hwCount, queue_size_t hwDataLength)
+{
+    if(hwDataLength > (queue_size_t)(this.hwTailCache - hwCount)) {
+        this.hwTailCache = __queue_load_acquire(&this.hwTailCount);
+    }
+    return this.hwTailCache;
+}
+
+/****************************************************************************
+* Function: __enqueue_bytes_counted                                       *
+* Description: Producer side of the counter based modes (SPSC and         *
+*              power-of-two). Only hwTail and hwTailCount are written,    *
+*              the consumer's hwHeadCount is read with acquire semantics. *
+*              Cover mode is only reachable with bMutex held, so it may   *
+*              move the consumer's counters as well.                      *
+****************************************************************************/
+static queue_size_t __enqueue_bytes_counted(byte_queue_t *ptThis, const uint8_t *pchByte, queue_size_t hwDataLength)
+{
+    queue_size_t hwTailCount = this.hwTailCount;  // Owned by the producer
+    queue_size_t hwHeadCount = __queue_head_count(ptThis, hwDataLength);
+    queue_size_t hwFree = this.hwSize - (queue_size_t)(hwTailCount - hwHeadCount);
+    if(hwDataLength > hwFree) {  // If not enough space
+        if(this.bIsCover == false) {  // If not allowed to overwrite
+            __queue_stats_truncated(ptThis, hwDataLength - hwFree);
+            hwDataLength = hwFree;  // Adjust data length
+        } else {  // If overwriting is allowed
+            if(hwDataLength > this.hwSize) {  // If data length exceeds queue size
+                __queue_stats_truncated(ptThis, hwDataLength - this.hwSize);
+                hwDataLength = this.hwSize;  // Limit data length to queue size
+            }
+            __queue_drop_counted(ptThis, hwHeadCount, hwDataLength - hwFree);
+        }
+    }
+    if(0 == hwDataLength) {
+        return 0;
+    }
+    queue_size_t hwTail = __queue_copy_in(ptThis, __queue_index(ptThis, hwTailCount, this.hwTail), pchByte, hwDataLength);
+    if(!this.bIsPow2) {
+        this.hwTail = hwTail;  // Only the wrapped index needs storing
+    }
+    __queue_store_release(&this.hwTailCount, (queue_size_t)(hwTailCount + hwDataLength));  // Publish the data
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: __dequeue_bytes_counted                                       *
+* Description: Consumer side of the counter based modes. Only hwHead,     *
+*              hwHeadCount and the peek cursor are written, the           *
+*              producer's hwTailCount is read with acquire semantics.     *
+****************************************************************************/
+static queue_size_t __dequeue_bytes_counted(byte_queue_t *ptThis, uint8_t *pchByte, queue_size_t hwDataLength)
+{
+    queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+    queue_size_t hwTailCount = __queue_tail_count(ptThis, hwHeadCount, hwDataLength);
+    queue_size_t hwLength = (queue_size_t)(hwTailCount - hwHeadCount);
+    if(hwDataLength > hwLength) {  // If requested length exceeds available data
+        hwDataLength = hwLength;  // Adjust data length
+    }
+    queue_size_t hwHead = __queue_copy_out(ptThis, __queue_index(ptThis, hwHeadCount, this.hwHead), pchByte, hwDataLength);
+    if(!this.bIsPow2) {
+        this.hwHead = hwHead;  // Only the wrapped index needs storing
+        this.hwPeek = hwHead;  // Update peek index
+    }
+    hwHeadCount += hwDataLength;
+    this.hwPeekCount = hwHeadCount;  // Update peek counter
+    __queue_store_release(&this.hwHeadCount, hwHeadCount);  // Hand the space back
+    return hwDataLength;
+}
 
+/****************************************************************************
+* Function: __peek_bytes_queue_counted                                    *
+* Description: Consumer side peek of the counter based modes.             *
+****************************************************************************/
+static queue_size_t __peek_bytes_queue_counted(byte_queue_t *ptThis, uint8_t *pchByte, queue_size_t hwDataLength)
+{
+    queue_size_t hwTailCount = __queue_tail_count(ptThis, this.hwPeekCount, hwDataLength);
+    queue_size_t hwPeekLength = (queue_size_t)(hwTailCount - this.hwPeekCount);
+    if(hwDataLength > hwPeekLength) {  // If requested length exceeds available data
+        hwDataLength = hwPeekLength;  // Adjust data length
+    }
+    if(0 == hwDataLength) {
+        return 0;
+    }
+    queue_size_t hwPeek = __queue_copy_out(ptThis, __queue_index(ptThis, this.hwPeekCount, this.hwPeek), pchByte, hwDataLength);
+    if(!this.bIsPow2) {
+        this.hwPeek = hwPeek;  // Only the wrapped index needs storing
+    }
+    this.hwPeekCount += hwDataLength;
+    return hwDataLength;
+}
 
 /****************************************************************************
 * Function: enqueue_bytes                                                 *
@@ -85,17 +688,29 @@ bool reset_queue(byte_queue_t *ptObj)
 * Returns: Number of bytes actually enqueued.                             *
 ****************************************************************************/
 
-uint16_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
+queue_size_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength)
 {
     assert(NULL != ptObj);  // Ensure ptObj is not NULL
     assert(NULL != pDate);  // Ensure pDate is not NULL
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;	
+    __queue_stats_start(wStart);
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        hwDataLength = __enqueue_bytes_counted(ptThis, pDate, hwDataLength);
+        __queue_stats_enqueued(ptThis, hwDataLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_readers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
     bool bEarlyReturn = false;  // Initialize early return flag
     safe_atom_code() {  // Start atomic section for thread safety
         if(this.hwHead == this.hwTail && 0 != this.hwLength) {  // Check if queue is full
             if(this.bIsCover == false) {  // If not allowed to overwrite
                 bEarlyReturn = true;							
+                __queue_stats_truncated(ptThis, hwDataLength);
                 continue;  // Exit atomic block
             }
         }			
@@ -103,22 +718,26 @@ uint16_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
             this.bMutex  = true;  // Lock the queue for thread safety
         } else {
             bEarlyReturn = true;  // Another thread is modifying the queue
+            __queue_stats_busy(ptThis);
         }					
     }
     if(bEarlyReturn) {
         return 0;  // Return 0 if queue is full or accessed by another thread
     }		
     uint8_t *pchByte = pDate;  // Cast data pointer to byte pointer
-    uint16_t hwTail = this.hwTail;  // Store current tail index
+    queue_size_t hwTail = this.hwTail;  // Store current tail index
     safe_atom_code() {  // Start atomic section for thread safety
         if(hwDataLength > this.hwSize) {  // If data length exceeds queue size
+            __queue_stats_truncated(ptThis, hwDataLength - this.hwSize);
             hwDataLength = this.hwSize;  // Limit data length to queue size
         }			
         if(hwDataLength > (this.hwSize - this.hwLength)) {  // If not enough space
             if(this.bIsCover == false) {  // If not allowed to overwrite
+                __queue_stats_truncated(ptThis, hwDataLength - (this.hwSize - this.hwLength));
                 hwDataLength = this.hwSize - this.hwLength;  // Adjust data length
             } else {  // If overwriting is allowed
-                uint16_t hwOverLength = hwDataLength - (this.hwSize - this.hwLength);  // Calculate overwrite length
+                queue_size_t hwOverLength = hwDataLength - (this.hwSize - this.hwLength);  // Calculate overwrite length
+                __queue_stats_overwritten(ptThis, hwOverLength);
                 if(hwOverLength < (this.hwSize - this.hwHead)) {
                     this.hwHead += hwOverLength;  // Move head forward
                 } else {
@@ -137,13 +756,10 @@ uint16_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
         this.hwLength += hwDataLength;  // Increase queue length
         this.hwPeekLength += hwDataLength;  // Increase peek length
     } 
-    if(hwDataLength <= (this.hwSize - hwTail)) {
-        memcpy(&this.pchBuffer[hwTail], pchByte, hwDataLength);  // Copy data to buffer
-    } else {
-        memcpy(&this.pchBuffer[hwTail], &pchByte[0], this.hwSize - hwTail);  // Copy first part
-        memcpy(&this.pchBuffer[0], &pchByte[this.hwSize - hwTail], hwDataLength - (this.hwSize - hwTail));  // Copy second part
-    }
+    __queue_copy_in(ptThis, hwTail, pchByte, hwDataLength);  // Copy data to buffer
+    __queue_stats_enqueued(ptThis, hwDataLength, wStart);
     this.bMutex = false;  // Unlock the queue
+    __queue_notify_readers(ptThis, hwDataLength);
     return hwDataLength;  // Return number of bytes enqueued
 }
 
@@ -158,13 +774,24 @@ uint16_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
 * Returns: Number of bytes actually dequeued.                             *
 ****************************************************************************/
 
-uint16_t dequeue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
+queue_size_t dequeue_bytes(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength)
 {
     assert(NULL != ptObj);  // Ensure ptObj is not NULL
     assert(NULL != pDate);  // Ensure pDate is not NULL
 
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    __queue_stats_start(wStart);
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        hwDataLength = __dequeue_bytes_counted(ptThis, pDate, hwDataLength);
+        __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
     bool bEarlyReturn = false;  // Initialize early return flag
     safe_atom_code() {  // Start atomic section for thread safety
         if(this.hwHead == this.hwTail && 0 == this.hwLength) {  // Check if queue is empty
@@ -175,13 +802,14 @@ uint16_t dequeue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
             this.bMutex  = true;  // Lock the queue for thread safety
         } else {
             bEarlyReturn = true;  // Another thread is modifying the queue
+            __queue_stats_busy(ptThis);
         }					
     }
     if(bEarlyReturn) {
         return 0;  // Return 0 if queue is empty or accessed by another thread
     }	
     uint8_t *pchByte = pDate;  // Cast data pointer to byte pointer
-    uint16_t hwHead = this.hwHead;  // Store current head index
+    queue_size_t hwHead = this.hwHead;  // Store current head index
     safe_atom_code() {  // Start atomic section for thread safety
         if(hwDataLength > this.hwLength) {  // If requested length exceeds available data
             hwDataLength = this.hwLength;  // Adjust data length
@@ -195,13 +823,10 @@ uint16_t dequeue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
         this.hwPeek = this.hwHead;  // Update peek index
         this.hwPeekLength = this.hwLength;  // Update peek length
     }	
-    if(hwDataLength <= (this.hwSize - hwHead)) {
-        memcpy(pchByte, &this.pchBuffer[hwHead], hwDataLength);  // Copy data from buffer
-    } else {
-        memcpy(&pchByte[0], &this.pchBuffer[hwHead], this.hwSize - hwHead);  // Copy first part
-        memcpy(&pchByte[this.hwSize - hwHead], &this.pchBuffer[0], hwDataLength - (this.hwSize - hwHead));  // Copy second part
-    }			
+    __queue_copy_out(ptThis, hwHead, pchByte, hwDataLength);  // Copy data from buffer
+    __queue_stats_dequeued(ptThis, hwDataLength, wStart);
     this.bMutex = false;  // Unlock the queue
+    __queue_notify_writers(ptThis, hwDataLength);
     return hwDataLength;  // Return number of bytes dequeued
 }
 
@@ -219,6 +844,11 @@ bool is_queue_empty(byte_queue_t *ptObj)
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
 
+    if (__queue_is_counted(ptThis)) {
+        return __queue_load_acquire(&this.hwTailCount)
+            == __queue_load_acquire(&this.hwHeadCount);
+    }
+
     if (this.hwHead == this.hwTail &&
         0 == this.hwLength ) {
         return true;
@@ -235,11 +865,15 @@ bool is_queue_empty(byte_queue_t *ptObj)
 * Returns: Number of elements in the queue.                               *
 ****************************************************************************/
 
-uint16_t get_queue_count(byte_queue_t *ptObj)
+queue_size_t get_queue_count(byte_queue_t *ptObj)
 {
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (__queue_is_counted(ptThis)) {
+        queue_size_t hwHeadCount = __queue_load_acquire(&this.hwHeadCount);
+        return (queue_size_t)(__queue_load_acquire(&this.hwTailCount) - hwHeadCount);
+    }
     return (this.hwLength);
 }
 /****************************************************************************
@@ -250,11 +884,15 @@ uint16_t get_queue_count(byte_queue_t *ptObj)
 * Returns: Available space in the queue.                                  *
 ****************************************************************************/
 
-uint16_t get_queue_available_count(byte_queue_t *ptObj)
+queue_size_t get_queue_available_count(byte_queue_t *ptObj)
 {
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (__queue_is_counted(ptThis)) {
+        queue_size_t hwTailCount = __queue_load_acquire(&this.hwTailCount);
+        return this.hwSize - (queue_size_t)(hwTailCount - __queue_load_acquire(&this.hwHeadCount));
+    }
     return (this.hwSize - this.hwLength);
 }
 
@@ -272,6 +910,10 @@ bool is_peek_empty(byte_queue_t *ptObj)
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
 
+    if (__queue_is_counted(ptThis)) {
+        return __queue_load_acquire(&this.hwTailCount) == this.hwPeekCount;
+    }
+
     if (this.hwPeek == this.hwTail &&
         0 == this.hwPeekLength ) {
         return true;
@@ -291,13 +933,21 @@ bool is_peek_empty(byte_queue_t *ptObj)
 * Returns: Number of bytes actually peeked.                               *
 ****************************************************************************/
 
-uint16_t peek_bytes_queue(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength)
+queue_size_t peek_bytes_queue(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength)
 {
     assert(NULL != ptObj);  // Ensure ptObj is not NULL
     assert(NULL != pDate);  // Ensure pDate is not NULL
 
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        hwDataLength = __peek_bytes_queue_counted(ptThis, pDate, hwDataLength);
+        __queue_leave(ptThis);
+        return hwDataLength;
+    }
 		
     bool bEarlyReturn = false;  // Initialize early return flag
     safe_atom_code() {  // Start atomic section for thread safety
@@ -309,13 +959,14 @@ uint16_t peek_bytes_queue(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLengt
             this.bMutex  = true;  // Lock the queue for thread safety
         } else {
             bEarlyReturn = true;  // Another thread is modifying the queue
+            __queue_stats_busy(ptThis);
         }					
     }
     if(bEarlyReturn) {
         return 0;  // Return 0 if peek buffer is empty or accessed by another thread
     }
     uint8_t *pchByte = pDate;  // Cast data pointer to byte pointer
-    uint16_t hwPeek = this.hwPeek;  // Store current peek index
+    queue_size_t hwPeek = this.hwPeek;  // Store current peek index
     safe_atom_code() {  // Start atomic section for thread safety
         if(hwDataLength > this.hwPeekLength) {  // If requested length exceeds available data
             hwDataLength = this.hwPeekLength;  // Adjust data length
@@ -327,12 +978,7 @@ uint16_t peek_bytes_queue(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLengt
         }
         this.hwPeekLength -= hwDataLength;  // Decrease peek length
     }
-    if(hwDataLength <= (this.hwSize - hwPeek)) {
-        memcpy(pchByte, &this.pchBuffer[hwPeek], hwDataLength);  // Copy data from buffer
-    } else {
-        memcpy(&pchByte[0], &this.pchBuffer[hwPeek], this.hwSize - hwPeek);  // Copy first part
-        memcpy(&pchByte[this.hwSize - hwPeek], &this.pchBuffer[0], hwDataLength - (this.hwSize - hwPeek));  // Copy second part
-    }
+    __queue_copy_out(ptThis, hwPeek, pchByte, hwDataLength);  // Copy data from buffer
     this.bMutex = false;  // Unlock the queue
     return hwDataLength;  // Return number of bytes peeked
 }
@@ -350,6 +996,15 @@ bool reset_peek(byte_queue_t *ptObj)
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (__queue_is_counted(ptThis)) {
+        if (!__queue_enter(ptThis)) {
+            return false;
+        }
+        this.hwPeek = this.hwHead;
+        this.hwPeekCount = this.hwHeadCount;
+        __queue_leave(ptThis);
+        return true;
+    }
     safe_atom_code() {
         this.hwPeek = this.hwHead;
         this.hwPeekLength = this.hwLength;
@@ -370,10 +1025,21 @@ bool get_all_peeked(byte_queue_t *ptObj)
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (__queue_is_counted(ptThis)) {
+        if (!__queue_enter(ptThis)) {
+            return false;
+        }
+        this.hwHead = this.hwPeek;
+        __queue_store_release(&this.hwHeadCount, this.hwPeekCount);
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, 1);
+        return true;
+    }
     safe_atom_code() {
         this.hwHead = this.hwPeek;
         this.hwLength = this.hwPeekLength;
     }
+    __queue_notify_writers(ptThis, 1);
     return true;
 }
 
@@ -385,12 +1051,15 @@ bool get_all_peeked(byte_queue_t *ptObj)
 * Returns: Current number of elements in the peek buffer.                *
 ****************************************************************************/
 
-uint16_t get_peek_status(byte_queue_t *ptObj)
+queue_size_t get_peek_status(byte_queue_t *ptObj)
 {
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
-    uint16_t hwCount;
+    queue_size_t hwCount;
+    if (__queue_is_counted(ptThis)) {
+        return (queue_size_t)(this.hwPeekCount - this.hwHeadCount);
+    }
     safe_atom_code() {
         if (this.hwPeek >= this.hwHead) {
             hwCount = this.hwPeek - this.hwHead;
@@ -410,11 +1079,22 @@ uint16_t get_peek_status(byte_queue_t *ptObj)
 * Returns: True if successful, false otherwise.                          *
 ****************************************************************************/
 
-bool restore_peek_status(byte_queue_t *ptObj, uint16_t hwCount)
+bool restore_peek_status(byte_queue_t *ptObj, queue_size_t hwCount)
 {
     assert(NULL != ptObj);
     /* initialise "this" (i.e. ptThis) to access class members */
     byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (__queue_is_counted(ptThis)) {
+        if (!__queue_enter(ptThis)) {
+            return false;
+        }
+        if (!this.bIsPow2) {
+            this.hwPeek = __queue_advance(ptThis, this.hwHead, hwCount);
+        }
+        this.hwPeekCount = this.hwHeadCount + hwCount;
+        __queue_leave(ptThis);
+        return true;
+    }
     safe_atom_code() {
         if (this.hwHead + hwCount < this.hwSize) {
             this.hwPeek = this.hwHead + hwCount;
@@ -426,3 +1106,1269 @@ bool restore_peek_status(byte_queue_t *ptObj, uint16_t hwCount)
     }
     return true;
 }
+
+/****************************************************************************
+* Function: __queue_fill_span                                             *
+* Description: Describes hwLength bytes starting at hwIndex as one or two *
+*              contiguous regions of the ring buffer.                     *
+****************************************************************************/
+static queue_size_t __queue_fill_span(byte_queue_t *ptThis, queue_size_t hwIndex, queue_size_t hwLength, queue_span_t tSpan[2])
+{
+    tSpan[0].pchBuffer = &this.pchBuffer[hwIndex];
+#if QUEUE_CFG_USE_MIRROR
+    if(this.bIsMirror || hwLength <= (this.hwSize - hwIndex)) {
+#else
+    if(hwLength <= (this.hwSize - hwIndex)) {
+#endif
+        tSpan[0].hwLength = hwLength;
+        tSpan[1].pchBuffer = &this.pchBuffer[0];
+        tSpan[1].hwLength = 0;
+    } else {
+        tSpan[0].hwLength = this.hwSize - hwIndex;
+        tSpan[1].pchBuffer = &this.pchBuffer[0];
+        tSpan[1].hwLength = hwLength - (this.hwSize - hwIndex);
+    }
+    return hwLength;
+}
+
+/****************************************************************************
+* Function: enqueue_reserve                                               *
+* Description: Hands out the free space of the byte queue for in-place    *
+*              writing. The queue stays locked until enqueue_commit().    *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - tSpan: Two spans receiving the writable regions.                    *
+* Returns: Total number of writable bytes.                                *
+****************************************************************************/
+
+queue_size_t enqueue_reserve(byte_queue_t *ptObj, queue_span_t tSpan[2])
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != tSpan);  // Ensure tSpan is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if(__queue_is_counted(ptThis)) {
+        queue_size_t hwFree = 0;
+        if(__queue_enter(ptThis)) {  // Held until the commit
+            queue_size_t hwHeadCount = __queue_head_count(ptThis, this.hwSize);
+            hwFree = this.hwSize - (queue_size_t)(this.hwTailCount - hwHeadCount);
+            if(0 == hwFree) {
+                __queue_leave(ptThis);
+            }
+        }
+        return __queue_fill_span(ptThis, __queue_index(ptThis, this.hwTailCount, this.hwTail), hwFree, tSpan);
+    }
+    bool bEarlyReturn = false;  // Initialize early return flag
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(this.hwLength == this.hwSize) {  // Check if queue is full
+            bEarlyReturn = true;
+            continue;  // Exit atomic block
+        }
+        if(!this.bMutex) {  // Check if mutex is free
+            this.bMutex  = true;  // Lock the queue until the commit
+        } else {
+            bEarlyReturn = true;  // Another thread is modifying the queue
+            __queue_stats_busy(ptThis);
+        }
+    }
+    if(bEarlyReturn) {
+        tSpan[0].hwLength = 0;
+        tSpan[1].hwLength = 0;
+        return 0;  // Return 0 if queue is full or accessed by another thread
+    }
+    return __queue_fill_span(ptThis, this.hwTail, this.hwSize - this.hwLength, tSpan);
+}
+
+/****************************************************************************
+* Function: enqueue_commit                                                *
+* Description: Publishes bytes written into the space handed out by       *
+*              enqueue_reserve() and unlocks the queue.                   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - hwDataLength: Number of bytes written.                              *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+
+queue_size_t enqueue_commit(byte_queue_t *ptObj, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    __queue_stats_start(wStart);
+    if(__queue_is_counted(ptThis)) {
+        queue_size_t hwTailCount = this.hwTailCount;  // Owned by the producer
+        queue_size_t hwFree = this.hwSize - (queue_size_t)(hwTailCount - __queue_head_count(ptThis, hwDataLength));
+        if(hwDataLength > hwFree) {
+            hwDataLength = hwFree;
+        }
+        if(!this.bIsPow2) {
+            this.hwTail = __queue_advance(ptThis, this.hwTail, hwDataLength);  // Move tail forward
+        }
+        __queue_store_release(&this.hwTailCount, (queue_size_t)(hwTailCount + hwDataLength));  // Publish the data
+        __queue_stats_enqueued(ptThis, hwDataLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_readers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(hwDataLength > (this.hwSize - this.hwLength)) {
+            hwDataLength = this.hwSize - this.hwLength;
+        }
+        if(hwDataLength < (this.hwSize - this.hwTail)) {
+            this.hwTail += hwDataLength;  // Move tail forward
+        } else {
+            this.hwTail = hwDataLength - (this.hwSize - this.hwTail);  // Wrap around
+        }
+        this.hwLength += hwDataLength;  // Increase queue length
+        this.hwPeekLength += hwDataLength;  // Increase peek length
+        __queue_stats_enqueued(ptThis, hwDataLength, wStart);
+        this.bMutex = false;  // Unlock the queue
+    }
+    __queue_notify_readers(ptThis, hwDataLength);
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: dequeue_acquire                                               *
+* Description: Exposes the queued data of the byte queue for in-place     *
+*              reading. The queue stays locked until dequeue_release().   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - tSpan: Two spans receiving the readable regions.                    *
+* Returns: Total number of readable bytes.                                *
+****************************************************************************/
+
+queue_size_t dequeue_acquire(byte_queue_t *ptObj, queue_span_t tSpan[2])
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != tSpan);  // Ensure tSpan is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if(__queue_is_counted(ptThis)) {
+        queue_size_t hwLength = 0;
+        if(__queue_enter(ptThis)) {  // Held until the release
+            queue_size_t hwTailCount = __queue_tail_count(ptThis, this.hwHeadCount, this.hwSize);
+            hwLength = (queue_size_t)(hwTailCount - this.hwHeadCount);
+            if(0 == hwLength) {
+                __queue_leave(ptThis);
+            }
+        }
+        return __queue_fill_span(ptThis, __queue_index(ptThis, this.hwHeadCount, this.hwHead), hwLength, tSpan);
+    }
+    bool bEarlyReturn = false;  // Initialize early return flag
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(0 == this.hwLength) {  // Check if queue is empty
+            bEarlyReturn = true;
+            continue;  // Exit atomic block
+        }
+        if(!this.bMutex) {  // Check if mutex is free
+            this.bMutex  = true;  // Lock the queue until the release
+        } else {
+            bEarlyReturn = true;  // Another thread is modifying the queue
+            __queue_stats_busy(ptThis);
+        }
+    }
+    if(bEarlyReturn) {
+        tSpan[0].hwLength = 0;
+        tSpan[1].hwLength = 0;
+        return 0;  // Return 0 if queue is empty or accessed by another thread
+    }
+    return __queue_fill_span(ptThis, this.hwHead, this.hwLength, tSpan);
+}
+
+/****************************************************************************
+* Function: dequeue_release                                               *
+* Description: Removes bytes read through dequeue_acquire() from the      *
+*              byte queue and unlocks the queue.                          *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - hwDataLength: Number of bytes consumed.                             *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+
+queue_size_t dequeue_release(byte_queue_t *ptObj, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    __queue_stats_start(wStart);
+    if(__queue_is_counted(ptThis)) {
+        queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+        queue_size_t hwLength = (queue_size_t)(__queue_tail_count(ptThis, hwHeadCount, hwDataLength) - hwHeadCount);
+        if(hwDataLength > hwLength) {
+            hwDataLength = hwLength;
+        }
+        if(!this.bIsPow2) {
+            this.hwHead = __queue_advance(ptThis, this.hwHead, hwDataLength);  // Move head forward
+            this.hwPeek = this.hwHead;  // Update peek index
+        }
+        hwHeadCount += hwDataLength;
+        this.hwPeekCount = hwHeadCount;  // Update peek counter
+        __queue_store_release(&this.hwHeadCount, hwHeadCount);  // Hand the space back
+        __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(hwDataLength > this.hwLength) {
+            hwDataLength = this.hwLength;
+        }
+        if(hwDataLength < (this.hwSize - this.hwHead)) {
+            this.hwHead += hwDataLength;  // Move head forward
+        } else {
+            this.hwHead = hwDataLength - (this.hwSize - this.hwHead);  // Wrap around
+        }
+        this.hwLength -= hwDataLength;  // Decrease queue length
+        this.hwPeek = this.hwHead;  // Update peek index
+        this.hwPeekLength = this.hwLength;  // Update peek length
+        __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+        this.bMutex = false;  // Unlock the queue
+    }
+    __queue_notify_writers(ptThis, hwDataLength);
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: __queue_vector_length                                         *
+* Description: Sums up the lengths of an I/O vector.                      *
+* Returns: Total length, or 0 if it exceeds the queue size.               *
+****************************************************************************/
+static queue_size_t __queue_vector_length(byte_queue_t *ptThis, const queue_iovec_t *ptVector, uint16_t hwVectorCount)
+{
+    uint32_t wTotal = 0;
+    for(uint16_t i = 0; i < hwVectorCount; i++) {
+        if(ptVector[i].hwLength > this.hwSize - wTotal) {
+            return 0;  // A record larger than the queue never fits
+        }
+        wTotal += ptVector[i].hwLength;
+    }
+    return (queue_size_t)wTotal;
+}
+
+/****************************************************************************
+* Function: __queue_drop_length                                           *
+* Description: Rounds the number of bytes cover mode has to discard up to *
+*              whole messages when the queue holds length-prefixed        *
+*              records, so the head never lands inside a record.          *
+*              Only called with bMutex held.                              *
+****************************************************************************/
+static queue_size_t __queue_drop_length(byte_queue_t *ptThis, queue_size_t hwIndex, queue_size_t hwOverLength)
+{
+    if(!this.bIsMessage) {
+        return hwOverLength;
+    }
+    queue_size_t hwDropLength = 0;
+    while(hwDropLength < hwOverLength) {
+        queue_size_t hwRecordLength;
+        hwIndex = __queue_copy_out(ptThis, hwIndex, (uint8_t *)&hwRecordLength, sizeof(hwRecordLength));
+        hwIndex = __queue_advance(ptThis, hwIndex, hwRecordLength);  // Skip the payload
+        hwDropLength += sizeof(hwRecordLength) + hwRecordLength;
+    }
+    return hwDropLength;
+}
+
+/****************************************************************************
+* Function: __enqueue_bytes_v                                             *
+* Description: Common part of enqueue_bytes_v() and enqueue_message().    *
+*              hwDataLength is the total length of the vector, which has  *
+*              already been checked against the queue size.               *
+****************************************************************************/
+static queue_size_t __enqueue_bytes_v(byte_queue_t *ptThis, const queue_iovec_t *ptVector, uint16_t hwVectorCount, queue_size_t hwDataLength)
+{
+    __queue_stats_start(wStart);
+    queue_size_t hwTail;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        queue_size_t hwTailCount = this.hwTailCount;  // Owned by the producer
+        queue_size_t hwHeadCount = __queue_head_count(ptThis, hwDataLength);
+        queue_size_t hwFree = this.hwSize - (queue_size_t)(hwTailCount - hwHeadCount);
+        if(hwDataLength > hwFree) {  // If not enough space
+            if(this.bIsCover == false) {  // If not allowed to overwrite
+                __queue_stats_truncated(ptThis, hwDataLength);
+                __queue_leave(ptThis);
+                return 0;
+            }
+            queue_size_t hwOverLength = __queue_drop_length(ptThis, __queue_index(ptThis, hwHeadCount, this.hwHead), hwDataLength - hwFree);
+            __queue_drop_counted(ptThis, hwHeadCount, hwOverLength);
+        }
+        hwTail = __queue_index(ptThis, hwTailCount, this.hwTail);
+        for(uint16_t i = 0; i < hwVectorCount; i++) {
+            hwTail = __queue_copy_in(ptThis, hwTail, ptVector[i].pBuffer, ptVector[i].hwLength);
+        }
+        if(!this.bIsPow2) {
+            this.hwTail = hwTail;  // Only the wrapped index needs storing
+        }
+        __queue_store_release(&this.hwTailCount, (queue_size_t)(hwTailCount + hwDataLength));  // Publish the data
+        __queue_stats_enqueued(ptThis, hwDataLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_readers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
+    if(!__queue_try_lock(ptThis)) {
+        return 0;  // Return 0 if the queue is accessed by another thread
+    }
+    bool bEarlyReturn = false;  // Initialize early return flag
+    safe_atom_code() {  // Start atomic section for thread safety
+        hwTail = this.hwTail;  // Store current tail index
+        if(hwDataLength > (this.hwSize - this.hwLength)) {  // If not enough space
+            if(this.bIsCover == false) {  // If not allowed to overwrite
+                bEarlyReturn = true;
+                __queue_stats_truncated(ptThis, hwDataLength);
+                continue;  // Exit atomic block
+            }
+            queue_size_t hwOverLength = __queue_drop_length(ptThis, this.hwHead, hwDataLength - (this.hwSize - this.hwLength));  // Calculate overwrite length
+            __queue_stats_overwritten(ptThis, hwOverLength);
+            this.hwHead = __queue_advance(ptThis, this.hwHead, hwOverLength);  // Move head forward
+            this.hwLength -= hwOverLength;  // Decrease length
+            this.hwPeek = this.hwHead;  // Update peek index
+            this.hwPeekLength = this.hwLength;  // Update peek length
+        }
+        this.hwTail = __queue_advance(ptThis, this.hwTail, hwDataLength);  // Move tail forward
+        this.hwLength += hwDataLength;  // Increase queue length
+        this.hwPeekLength += hwDataLength;  // Increase peek length
+    }
+    if(bEarlyReturn) {
+        this.bMutex = false;  // Unlock the queue
+        return 0;  // Return 0 if the whole vector does not fit
+    }
+    for(uint16_t i = 0; i < hwVectorCount; i++) {
+        hwTail = __queue_copy_in(ptThis, hwTail, ptVector[i].pBuffer, ptVector[i].hwLength);
+    }
+    __queue_stats_enqueued(ptThis, hwDataLength, wStart);
+    this.bMutex = false;  // Unlock the queue
+    __queue_notify_readers(ptThis, hwDataLength);
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: enqueue_bytes_v                                               *
+* Description: Enqueues the buffers of an I/O vector as one unit: either  *
+*              all of them are stored or none is.                         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - ptVector: Buffers to be enqueued, in order.                         *
+*   - hwVectorCount: Number of buffers.                                   *
+* Returns: Number of bytes enqueued, either the total length or 0.       *
+****************************************************************************/
+
+queue_size_t enqueue_bytes_v(byte_queue_t *ptObj, const queue_iovec_t *ptVector, uint16_t hwVectorCount)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != ptVector);  // Ensure ptVector is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    queue_size_t hwDataLength = __queue_vector_length(ptThis, ptVector, hwVectorCount);
+    if(0 == hwDataLength) {
+        return 0;
+    }
+    return __enqueue_bytes_v(ptThis, ptVector, hwVectorCount, hwDataLength);
+}
+
+/****************************************************************************
+* Function: dequeue_bytes_v                                               *
+* Description: Dequeues into the buffers of an I/O vector as one unit:    *
+*              either all of them are filled or nothing is removed.       *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - ptVector: Buffers to be filled, in order.                           *
+*   - hwVectorCount: Number of buffers.                                   *
+* Returns: Number of bytes dequeued, either the total length or 0.       *
+****************************************************************************/
+
+queue_size_t dequeue_bytes_v(byte_queue_t *ptObj, const queue_iovec_t *ptVector, uint16_t hwVectorCount)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != ptVector);  // Ensure ptVector is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    __queue_stats_start(wStart);
+    queue_size_t hwDataLength = __queue_vector_length(ptThis, ptVector, hwVectorCount);
+    if(0 == hwDataLength) {
+        return 0;
+    }
+    queue_size_t hwHead;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+        queue_size_t hwTailCount = __queue_tail_count(ptThis, hwHeadCount, hwDataLength);
+        if(hwDataLength > (queue_size_t)(hwTailCount - hwHeadCount)) {  // If not enough data
+            __queue_leave(ptThis);
+            return 0;
+        }
+        hwHead = __queue_index(ptThis, hwHeadCount, this.hwHead);
+        for(uint16_t i = 0; i < hwVectorCount; i++) {
+            hwHead = __queue_copy_out(ptThis, hwHead, ptVector[i].pBuffer, ptVector[i].hwLength);
+        }
+        if(!this.bIsPow2) {
+            this.hwHead = hwHead;  // Only the wrapped index needs storing
+            this.hwPeek = hwHead;  // Update peek index
+        }
+        hwHeadCount += hwDataLength;
+        this.hwPeekCount = hwHeadCount;  // Update peek counter
+        __queue_store_release(&this.hwHeadCount, hwHeadCount);  // Hand the space back
+        __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
+    if(!__queue_try_lock(ptThis)) {
+        return 0;  // Return 0 if the queue is accessed by another thread
+    }
+    bool bEarlyReturn = false;  // Initialize early return flag
+    safe_atom_code() {  // Start atomic section for thread safety
+        hwHead = this.hwHead;  // Store current head index
+        if(hwDataLength > this.hwLength) {  // If not enough data
+            bEarlyReturn = true;
+            continue;  // Exit atomic block
+        }
+        this.hwHead = __queue_advance(ptThis, this.hwHead, hwDataLength);  // Move head forward
+        this.hwLength -= hwDataLength;  // Decrease queue length
+        this.hwPeek = this.hwHead;  // Update peek index
+        this.hwPeekLength = this.hwLength;  // Update peek length
+    }
+    if(bEarlyReturn) {
+        this.bMutex = false;  // Unlock the queue
+        return 0;  // Return 0 if the queue holds less than the whole vector
+    }
+    for(uint16_t i = 0; i < hwVectorCount; i++) {
+        hwHead = __queue_copy_out(ptThis, hwHead, ptVector[i].pBuffer, ptVector[i].hwLength);
+    }
+    __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+    this.bMutex = false;  // Unlock the queue
+    __queue_notify_writers(ptThis, hwDataLength);
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: queue_init_message                                            *
+* Description: Initializes a byte queue that carries length-prefixed      *
+*              messages. Cover mode then discards whole messages.         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object to be initialized.       *
+*   - pBuffer: Pointer to the buffer for storing data.                    *
+*   - hwItemSize: Size of the buffer in bytes.                            *
+*   - bIsCover: Indicates whether the queue should overwrite when full.  *
+* Returns: Pointer to the initialized byte_queue_t object or NULL.       *
+****************************************************************************/
+byte_queue_t *queue_init_message(byte_queue_t *ptObj, void *pBuffer, queue_size_t hwItemSize, bool bIsCover)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+
+    if (NULL == queue_init_byte(ptObj, pBuffer, hwItemSize, bIsCover)) {
+        return NULL;
+    }
+    safe_atom_code() {
+        this.bIsMessage = true;
+    }
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: enqueue_message                                               *
+* Description: Stores one length-prefixed message, whole or not at all.   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - pDate: Pointer to the message.                                      *
+*   - hwDataLength: Length of the message, at least 1 byte.               *
+* Returns: hwDataLength if the message was stored, 0 otherwise.           *
+****************************************************************************/
+queue_size_t enqueue_message(byte_queue_t *ptObj, const void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if(0 == hwDataLength || this.hwSize < sizeof(queue_size_t)
+    || hwDataLength > this.hwSize - sizeof(queue_size_t)) {
+        return 0;  // Empty messages and messages larger than the queue are rejected
+    }
+    queue_iovec_t tRecord[2] = {
+        {&hwDataLength, sizeof(queue_size_t)},
+        {(void *)pDate, hwDataLength},
+    };
+    if(0 == __enqueue_bytes_v(ptThis, tRecord, 2, sizeof(queue_size_t) + hwDataLength)) {
+        return 0;
+    }
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: get_queue_message_size                                        *
+* Description: Reads the length of the oldest message without removing it.*
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: Length of the next message, or 0 if there is none.            *
+****************************************************************************/
+queue_size_t get_queue_message_size(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    queue_size_t hwRecordLength = 0;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+        queue_size_t hwTailCount = __queue_tail_count(ptThis, hwHeadCount, sizeof(queue_size_t));
+        if((queue_size_t)(hwTailCount - hwHeadCount) >= sizeof(queue_size_t)) {
+            __queue_copy_out(ptThis, __queue_index(ptThis, hwHeadCount, this.hwHead), (uint8_t *)&hwRecordLength, sizeof(queue_size_t));
+        }
+        __queue_leave(ptThis);
+        return hwRecordLength;
+    }
+    if(!__queue_try_lock(ptThis)) {
+        return 0;  // Return 0 if the queue is accessed by another thread
+    }
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(this.hwLength >= sizeof(queue_size_t)) {
+            __queue_copy_out(ptThis, this.hwHead, (uint8_t *)&hwRecordLength, sizeof(queue_size_t));
+        }
+    }
+    this.bMutex = false;  // Unlock the queue
+    return hwRecordLength;
+}
+
+/****************************************************************************
+* Function: dequeue_message                                               *
+* Description: Removes exactly one message from the queue. A message that *
+*              does not fit into the caller's buffer is left in place.    *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - pDate: Buffer receiving the message.                                *
+*   - hwBufferSize: Size of that buffer.                                  *
+* Returns: Length of the message, or 0 if none was removed.              *
+****************************************************************************/
+queue_size_t dequeue_message(byte_queue_t *ptObj, void *pDate, queue_size_t hwBufferSize)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    __queue_stats_start(wStart);
+    queue_size_t hwRecordLength = 0;
+    queue_size_t hwHead;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+        queue_size_t hwTailCount = __queue_tail_count(ptThis, hwHeadCount, sizeof(queue_size_t));
+        if((queue_size_t)(hwTailCount - hwHeadCount) < sizeof(queue_size_t)) {  // If the queue is empty
+            __queue_leave(ptThis);
+            return 0;
+        }
+        hwHead = __queue_copy_out(ptThis, __queue_index(ptThis, hwHeadCount, this.hwHead), (uint8_t *)&hwRecordLength, sizeof(queue_size_t));
+        if(hwRecordLength > hwBufferSize) {  // If the message does not fit
+            __queue_leave(ptThis);
+            return 0;
+        }
+        hwHead = __queue_copy_out(ptThis, hwHead, pDate, hwRecordLength);
+        if(!this.bIsPow2) {
+            this.hwHead = hwHead;  // Only the wrapped index needs storing
+            this.hwPeek = hwHead;  // Update peek index
+        }
+        hwHeadCount += sizeof(queue_size_t) + hwRecordLength;
+        this.hwPeekCount = hwHeadCount;  // Update peek counter
+        __queue_store_release(&this.hwHeadCount, hwHeadCount);  // Hand the space back
+        __queue_stats_dequeued(ptThis, sizeof(queue_size_t) + hwRecordLength, wStart);
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, sizeof(queue_size_t) + hwRecordLength);
+        return hwRecordLength;
+    }
+    if(!__queue_try_lock(ptThis)) {
+        return 0;  // Return 0 if the queue is accessed by another thread
+    }
+    bool bEarlyReturn = false;  // Initialize early return flag
+    safe_atom_code() {  // Start atomic section for thread safety
+        if(this.hwLength < sizeof(queue_size_t)) {  // If the queue is empty
+            bEarlyReturn = true;
+            continue;  // Exit atomic block
+        }
+        hwHead = __queue_copy_out(ptThis, this.hwHead, (uint8_t *)&hwRecordLength, sizeof(queue_size_t));
+        if(hwRecordLength > hwBufferSize) {  // If the message does not fit
+            bEarlyReturn = true;
+            continue;  // Exit atomic block
+        }
+        this.hwHead = __queue_advance(ptThis, hwHead, hwRecordLength);  // Move head forward
+        this.hwLength -= sizeof(queue_size_t) + hwRecordLength;  // Decrease queue length
+        this.hwPeek = this.hwHead;  // Update peek index
+        this.hwPeekLength = this.hwLength;  // Update peek length
+    }
+    if(bEarlyReturn) {
+        this.bMutex = false;  // Unlock the queue
+        return 0;
+    }
+    __queue_copy_out(ptThis, hwHead, pDate, hwRecordLength);
+    __queue_stats_dequeued(ptThis, sizeof(queue_size_t) + hwRecordLength, wStart);
+    this.bMutex = false;  // Unlock the queue
+    __queue_notify_writers(ptThis, sizeof(queue_size_t) + hwRecordLength);
+    return hwRecordLength;
+}
+
+/****************************************************************************
+* Function: __queue_match                                                 *
+* Description: Compares hwLength queued bytes starting at hwIndex with a  *
+*              pattern, following the data across the end of the buffer. *
+****************************************************************************/
+static bool __queue_match(byte_queue_t *ptThis, queue_size_t hwIndex, const uint8_t *pchPattern, queue_size_t hwLength)
+{
+    queue_size_t hwFirst = this.hwSize - hwIndex;
+#if QUEUE_CFG_USE_MIRROR
+    if(this.bIsMirror) {  // The second mapping continues the first one
+        hwFirst = hwLength;
+    }
+#endif
+    if(hwLength <= hwFirst) {
+        return 0 == memcmp(&this.pchBuffer[hwIndex], pchPattern, hwLength);
+    }
+    return 0 == memcmp(&this.pchBuffer[hwIndex], &pchPattern[0], hwFirst)  // Compare first part
+        && 0 == memcmp(&this.pchBuffer[0], &pchPattern[hwFirst], hwLength - hwFirst);  // Compare second part
+}
+
+/****************************************************************************
+* Function: __queue_scan                                                  *
+* Description: Searches hwLength queued bytes starting at hwIndex for a   *
+*              pattern. Candidates are located with memchr() over each    *
+*              contiguous region, which the C library vectorises, and     *
+*              only then compared in full.                                *
+****************************************************************************/
+static bool __queue_scan(byte_queue_t *ptThis, queue_size_t hwIndex, queue_size_t hwLength,
+                         const uint8_t *pchPattern, queue_size_t hwPatternLength, queue_size_t *phwOffset)
+{
+    if(0 == hwPatternLength || hwPatternLength > hwLength) {
+        return false;
+    }
+    queue_size_t hwLast = hwLength - hwPatternLength;  // Last offset a match may start at
+    queue_size_t hwOffset = 0;
+    while(hwOffset <= hwLast) {
+        queue_size_t hwStart = __queue_advance(ptThis, hwIndex, hwOffset);
+        queue_size_t hwRun = hwLast - hwOffset + 1;
+#if QUEUE_CFG_USE_MIRROR
+        if(!this.bIsMirror && hwRun > this.hwSize - hwStart) {
+#else
+        if(hwRun > this.hwSize - hwStart) {
+#endif
+            hwRun = this.hwSize - hwStart;  // Stop at the end of the buffer
+        }
+        const uint8_t *pchHit = memchr(&this.pchBuffer[hwStart], pchPattern[0], hwRun);
+        if(NULL == pchHit) {
+            hwOffset += hwRun;
+            continue;
+        }
+        queue_size_t hwSkip = (queue_size_t)(pchHit - &this.pchBuffer[hwStart]);
+        hwOffset += hwSkip;
+        if(1 == hwPatternLength
+        || __queue_match(ptThis, __queue_advance(ptThis, hwStart, hwSkip), pchPattern, hwPatternLength)) {
+            *phwOffset = hwOffset;
+            return true;
+        }
+        hwOffset++;
+    }
+    return false;
+}
+
+/****************************************************************************
+* Function: __queue_find                                                  *
+* Description: Consumer side search of the whole queued data, shared by   *
+*              queue_find_byte() and queue_find_pattern().                *
+****************************************************************************/
+static bool __queue_find(byte_queue_t *ptThis, const uint8_t *pchPattern, queue_size_t hwPatternLength, queue_size_t *phwOffset)
+{
+    bool bFound;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return false;  // Return false if the queue is accessed by another thread
+        }
+        queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+        queue_size_t hwTailCount = __queue_tail_count(ptThis, hwHeadCount, this.hwSize);
+        bFound = __queue_scan(ptThis, __queue_index(ptThis, hwHeadCount, this.hwHead),
+                              (queue_size_t)(hwTailCount - hwHeadCount), pchPattern, hwPatternLength, phwOffset);
+        __queue_leave(ptThis);
+        return bFound;
+    }
+    if(!__queue_try_lock(ptThis)) {
+        return false;  // Return false if the queue is accessed by another thread
+    }
+    queue_size_t hwHead, hwLength;
+    safe_atom_code() {  // Start atomic section for thread safety
+        hwHead = this.hwHead;
+        hwLength = this.hwLength;
+    }
+    bFound = __queue_scan(ptThis, hwHead, hwLength, pchPattern, hwPatternLength, phwOffset);
+    this.bMutex = false;  // Unlock the queue
+    return bFound;
+}
+
+/****************************************************************************
+* Function: queue_find_byte                                               *
+* Description: Finds the first queued occurrence of a byte in place.      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - chByte: The byte to look for.                                       *
+*   - phwOffset: Receives its offset from the oldest queued byte.         *
+* Returns: True if the byte was found, false otherwise.                  *
+****************************************************************************/
+bool queue_find_byte(byte_queue_t *ptObj, uint8_t chByte, queue_size_t *phwOffset)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != phwOffset);  // Ensure phwOffset is not NULL
+    return __queue_find((byte_queue_t *)ptObj, &chByte, 1, phwOffset);
+}
+
+/****************************************************************************
+* Function: queue_find_pattern                                            *
+* Description: Finds the first queued occurrence of a byte sequence.      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - pPattern: Pointer to the sequence.                                  *
+*   - hwPatternLength: Length of the sequence.                            *
+*   - phwOffset: Receives the offset of its first byte.                   *
+* Returns: True if the sequence was found, false otherwise.              *
+****************************************************************************/
+bool queue_find_pattern(byte_queue_t *ptObj, const void *pPattern, queue_size_t hwPatternLength, queue_size_t *phwOffset)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pPattern);  // Ensure pPattern is not NULL
+    assert(NULL != phwOffset);  // Ensure phwOffset is not NULL
+    return __queue_find((byte_queue_t *)ptObj, pPattern, hwPatternLength, phwOffset);
+}
+
+/****************************************************************************
+* Function: dequeue_until                                                 *
+* Description: Removes the bytes up to and including the first delimiter. *
+*              Only the first hwBufferSize bytes are searched, a longer   *
+*              record is left in place.                                   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - chDelimiter: The byte terminating a record.                         *
+*   - pDate: Buffer receiving the record.                                 *
+*   - hwBufferSize: Size of that buffer.                                  *
+* Returns: Length of the record, or 0 if none was removed.               *
+****************************************************************************/
+queue_size_t dequeue_until(byte_queue_t *ptObj, uint8_t chDelimiter, void *pDate, queue_size_t hwBufferSize)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    __queue_stats_start(wStart);
+    queue_size_t hwDataLength = 0;
+    if(__queue_is_counted(ptThis)) {
+        if(!__queue_enter(ptThis)) {
+            return 0;  // Return 0 if the queue is accessed by another thread
+        }
+        queue_size_t hwHeadCount = this.hwHeadCount;  // Owned by the consumer
+        queue_size_t hwTailCount = __queue_tail_count(ptThis, hwHeadCount, this.hwSize);
+        queue_size_t hwLength = (queue_size_t)(hwTailCount - hwHeadCount);
+        if(hwLength > hwBufferSize) {
+            hwLength = hwBufferSize;  // The record must fit into the caller's buffer
+        }
+        if(__queue_scan(ptThis, __queue_index(ptThis, hwHeadCount, this.hwHead), hwLength, &chDelimiter, 1, &hwDataLength)) {
+            hwDataLength = __dequeue_bytes_counted(ptThis, pDate, hwDataLength + 1);
+            __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+        }
+        __queue_leave(ptThis);
+        __queue_notify_writers(ptThis, hwDataLength);
+        return hwDataLength;
+    }
+    if(!__queue_try_lock(ptThis)) {
+        return 0;  // Return 0 if the queue is accessed by another thread
+    }
+    queue_size_t hwHead, hwLength;
+    safe_atom_code() {  // Start atomic section for thread safety
+        hwHead = this.hwHead;
+        hwLength = this.hwLength;
+    }
+    if(hwLength > hwBufferSize) {
+        hwLength = hwBufferSize;  // The record must fit into the caller's buffer
+    }
+    if(!__queue_scan(ptThis, hwHead, hwLength, &chDelimiter, 1, &hwDataLength)) {
+        this.bMutex = false;  // Unlock the queue
+        return 0;
+    }
+    hwDataLength += 1;  // Include the delimiter
+    safe_atom_code() {  // Start atomic section for thread safety
+        this.hwHead = __queue_advance(ptThis, this.hwHead, hwDataLength);  // Move head forward
+        this.hwLength -= hwDataLength;  // Decrease queue length
+        this.hwPeek = this.hwHead;  // Update peek index
+        this.hwPeekLength = this.hwLength;  // Update peek length
+    }
+    __queue_copy_out(ptThis, hwHead, pDate, hwDataLength);
+    __queue_stats_dequeued(ptThis, hwDataLength, wStart);
+    this.bMutex = false;  // Unlock the queue
+    __queue_notify_writers(ptThis, hwDataLength);
+    return hwDataLength;
+}
+
+#if QUEUE_CFG_STATS
+/****************************************************************************
+* Function: get_queue_stats                                               *
+* Description: Copies the traffic counters of the byte queue.             *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - ptStats: Receives the counters.                                     *
+* Returns: True once the counters are copied.                            *
+****************************************************************************/
+bool get_queue_stats(byte_queue_t *ptObj, queue_stats_t *ptStats)
+{
+    assert(NULL != ptObj);
+    assert(NULL != ptStats);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    ptStats->dwEnqueueOps = __atomic_load_n(&this.tStats.dwEnqueueOps, __ATOMIC_RELAXED);
+    ptStats->dwEnqueueBytes = __atomic_load_n(&this.tStats.dwEnqueueBytes, __ATOMIC_RELAXED);
+    ptStats->dwDequeueOps = __atomic_load_n(&this.tStats.dwDequeueOps, __ATOMIC_RELAXED);
+    ptStats->dwDequeueBytes = __atomic_load_n(&this.tStats.dwDequeueBytes, __ATOMIC_RELAXED);
+    ptStats->dwOverwrittenBytes = __atomic_load_n(&this.tStats.dwOverwrittenBytes, __ATOMIC_RELAXED);
+    ptStats->dwTruncatedBytes = __atomic_load_n(&this.tStats.dwTruncatedBytes, __ATOMIC_RELAXED);
+    ptStats->dwBusyRejects = __atomic_load_n(&this.tStats.dwBusyRejects, __ATOMIC_RELAXED);
+    ptStats->hwHighWater = __atomic_load_n(&this.tStats.hwHighWater, __ATOMIC_RELAXED);
+#if QUEUE_CFG_STATS_HISTOGRAM
+    for(uint32_t i = 0; i < QUEUE_STATS_HISTOGRAM_BUCKETS; i++) {
+        ptStats->wEnqueueLatency[i] = __atomic_load_n(&this.tStats.wEnqueueLatency[i], __ATOMIC_RELAXED);
+        ptStats->wDequeueLatency[i] = __atomic_load_n(&this.tStats.wDequeueLatency[i], __ATOMIC_RELAXED);
+    }
+#endif
+    return true;
+}
+
+/****************************************************************************
+* Function: reset_queue_stats                                             *
+* Description: Zeroes the traffic counters of the byte queue.             *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: True once the counters are reset.                             *
+****************************************************************************/
+bool reset_queue_stats(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    safe_atom_code() {  // Keeps the safe_atom_code() counters consistent
+        memset(&this.tStats, 0, sizeof(this.tStats));
+    }
+    return true;
+}
+#endif
+
+#if QUEUE_CFG_USE_MIRROR
+/****************************************************************************
+* Function: __queue_map_mirror                                            *
+* Description: Maps one memfd twice back-to-back, so the byte following   *
+*              the end of the ring buffer is its first byte again.        *
+* Returns: Start of the first mapping, or NULL on failure.               *
+****************************************************************************/
+static uint8_t *__queue_map_mirror(queue_size_t hwItemSize)
+{
+    long lPageSize = sysconf(_SC_PAGESIZE);
+    if (0 == hwItemSize || lPageSize <= 0 || 0 != (hwItemSize % (size_t)lPageSize)) {
+        return NULL;  // Both mappings must start on a page boundary
+    }
+    int nFd = (int)syscall(SYS_memfd_create, "byte_queue", MFD_CLOEXEC);
+    if (nFd < 0) {
+        return NULL;
+    }
+    uint8_t *pchBase = NULL;
+    if (0 == ftruncate(nFd, hwItemSize)) {
+        /* reserve the whole window first so nothing else can land in it */
+        void *pWindow = mmap(NULL, 2 * (size_t)hwItemSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED != pWindow) {
+            pchBase = pWindow;
+            if (MAP_FAILED == mmap(pchBase, hwItemSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, nFd, 0)
+            ||  MAP_FAILED == mmap(pchBase + hwItemSize, hwItemSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, nFd, 0)) {
+                munmap(pWindow, 2 * (size_t)hwItemSize);
+                pchBase = NULL;
+            }
+        }
+    }
+    close(nFd);  // The mappings keep the memory alive
+    return pchBase;
+}
+
+/****************************************************************************
+* Function: queue_init_mirror                                             *
+* Description: Initializes a byte queue on a double-mapped buffer.        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object to be initialized.       *
+*   - hwItemSize: Size of the buffer, a multiple of the page size.        *
+*   - bIsCover: Indicates whether the queue should overwrite when full.  *
+* Returns: Pointer to the initialized byte_queue_t object or NULL.       *
+****************************************************************************/
+byte_queue_t *queue_init_mirror(byte_queue_t *ptObj, queue_size_t hwItemSize, bool bIsCover)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    uint8_t *pchBuffer = __queue_map_mirror(hwItemSize);
+    if (NULL == pchBuffer) {
+        return NULL;
+    }
+    queue_init_byte(ptObj, pchBuffer, hwItemSize, bIsCover);
+    safe_atom_code() {
+        this.bIsMirror = true;
+    }
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: queue_init_spsc_mirror                                        *
+* Description: SPSC counterpart of queue_init_mirror().                   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object to be initialized.       *
+*   - hwItemSize: Size of the buffer, a multiple of the page size.        *
+* Returns: Pointer to the initialized byte_queue_t object or NULL.       *
+****************************************************************************/
+byte_queue_t *queue_init_spsc_mirror(byte_queue_t *ptObj, queue_size_t hwItemSize)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    uint8_t *pchBuffer = __queue_map_mirror(hwItemSize);
+    if (NULL == pchBuffer) {
+        return NULL;
+    }
+    queue_init_spsc(ptObj, pchBuffer, hwItemSize);
+    this.bIsMirror = true;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: queue_deinit_mirror                                           *
+* Description: Unmaps the buffer of a double-mapped byte queue.           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: True on success, false if the queue is not double-mapped.     *
+****************************************************************************/
+bool queue_deinit_mirror(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    if (!this.bIsMirror) {
+        return false;
+    }
+    munmap(this.pchBuffer, 2 * (size_t)this.hwSize);
+    this.pchBuffer = NULL;
+    this.hwSize = 0;
+    this.bIsMirror = false;
+    return true;
+}
+#endif
+
+#if QUEUE_CFG_USE_FUTEX
+/****************************************************************************
+* Function: __queue_deadline                                              *
+* Description: Turns a relative time limit into an absolute deadline on   *
+*              CLOCK_MONOTONIC. A negative limit means no deadline.       *
+****************************************************************************/
+static struct timespec *__queue_deadline(struct timespec *ptDeadline, int32_t nTimeoutMs)
+{
+    if(nTimeoutMs < 0) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, ptDeadline);
+    ptDeadline->tv_sec += nTimeoutMs / 1000;
+    ptDeadline->tv_nsec += (long)(nTimeoutMs % 1000) * 1000000L;
+    if(ptDeadline->tv_nsec >= 1000000000L) {
+        ptDeadline->tv_sec += 1;
+        ptDeadline->tv_nsec -= 1000000000L;
+    }
+    return ptDeadline;
+}
+
+/****************************************************************************
+* Function: __queue_time_left                                             *
+* Description: Computes the time left until a deadline.                   *
+* Returns: False if the deadline has passed.                             *
+****************************************************************************/
+static bool __queue_time_left(const struct timespec *ptDeadline, struct timespec *ptLeft)
+{
+    struct timespec tNow;
+    clock_gettime(CLOCK_MONOTONIC, &tNow);
+    ptLeft->tv_sec = ptDeadline->tv_sec - tNow.tv_sec;
+    ptLeft->tv_nsec = ptDeadline->tv_nsec - tNow.tv_nsec;
+    if(ptLeft->tv_nsec < 0) {
+        ptLeft->tv_sec -= 1;
+        ptLeft->tv_nsec += 1000000000L;
+    }
+    return ptLeft->tv_sec >= 0;
+}
+
+/****************************************************************************
+* Function: __queue_park                                                  *
+* Description: Registers as a waiter and sleeps on the futex word unless  *
+*              the queue became ready in the meantime.                    *
+* Parameters:                                                             *
+*   - ptThis: Pointer to the byte_queue_t object.                        *
+*   - bIsWriter: Waits for free space if true, for data otherwise.        *
+*   - ptDeadline: Absolute deadline or NULL to wait forever.              *
+* Returns: False if the deadline has passed.                             *
+****************************************************************************/
+static bool __queue_park(byte_queue_t *ptThis, bool bIsWriter, const struct timespec *ptDeadline)
+{
+    uint32_t *pwEvent = bIsWriter ? &this.wWriteEvent : &this.wReadEvent;
+    uint32_t *pwWaiters = bIsWriter ? &this.wWriteWaiters : &this.wReadWaiters;
+    struct timespec tLeft, *ptLeft = NULL;
+    bool bInTime = true;
+
+    __atomic_fetch_add(pwWaiters, 1, __ATOMIC_SEQ_CST);  // Make wakers take the slow path
+    uint32_t wEvent = __atomic_load_n(pwEvent, __ATOMIC_SEQ_CST);
+    bool bIsReady = bIsWriter ? (0 != get_queue_available_count(ptThis))
+                              : !is_queue_empty(ptThis);
+    if(!bIsReady) {
+        if(NULL != ptDeadline) {
+            bInTime = __queue_time_left(ptDeadline, &tLeft);
+            ptLeft = &tLeft;
+        }
+        if(bInTime) {
+            /* returns at once if wEvent is stale, i.e. a wake-up raced us */
+            syscall(SYS_futex, pwEvent, FUTEX_WAIT_PRIVATE, wEvent, ptLeft, NULL, 0);
+        }
+    }
+    __atomic_fetch_sub(pwWaiters, 1, __ATOMIC_RELAXED);
+    return bInTime;
+}
+
+/****************************************************************************
+* Function: enqueue_bytes_timeout                                         *
+* Description: Enqueues multiple bytes, waiting for free space.          *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - hwDataLength: Number of bytes to enqueue.                           *
+*   - nTimeoutMs: Time limit in milliseconds, negative to wait forever.   *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+queue_size_t enqueue_bytes_timeout(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength, int32_t nTimeoutMs)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;  // Cast data pointer to byte pointer
+    struct timespec tDeadline, tLeft;
+    struct timespec *ptDeadline = __queue_deadline(&tDeadline, nTimeoutMs);
+    queue_size_t hwDone = 0;
+
+    while(hwDone < hwDataLength) {
+        queue_size_t hwCount = enqueue_bytes(ptThis, &pchByte[hwDone], hwDataLength - hwDone);
+        if(0 != hwCount) {
+            hwDone += hwCount;
+            continue;
+        }
+        if(0 != get_queue_available_count(ptThis)) {  // Only bMutex was busy
+            if(NULL != ptDeadline && !__queue_time_left(ptDeadline, &tLeft)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if(!__queue_park(ptThis, true, ptDeadline)) {
+            break;  // Timed out
+        }
+    }
+    return hwDone;
+}
+
+/****************************************************************************
+* Function: dequeue_bytes_timeout                                         *
+* Description: Dequeues multiple bytes, waiting for the data.            *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - hwDataLength: Number of bytes to dequeue.                           *
+*   - nTimeoutMs: Time limit in milliseconds, negative to wait forever.   *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+queue_size_t dequeue_bytes_timeout(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength, int32_t nTimeoutMs)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;  // Cast data pointer to byte pointer
+    struct timespec tDeadline, tLeft;
+    struct timespec *ptDeadline = __queue_deadline(&tDeadline, nTimeoutMs);
+    queue_size_t hwDone = 0;
+
+    while(hwDone < hwDataLength) {
+        queue_size_t hwCount = dequeue_bytes(ptThis, &pchByte[hwDone], hwDataLength - hwDone);
+        if(0 != hwCount) {
+            hwDone += hwCount;
+            continue;
+        }
+        if(!is_queue_empty(ptThis)) {  // Only bMutex was busy
+            if(NULL != ptDeadline && !__queue_time_left(ptDeadline, &tLeft)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        if(!__queue_park(ptThis, false, ptDeadline)) {
+            break;  // Timed out
+        }
+    }
+    return hwDone;
+}
+#endif
+
+#if QUEUE_CFG_USE_EVENTFD
+/****************************************************************************
+* Function: queue_init_eventfd                                            *
+* Description: Attaches a read and a write eventfd to the byte queue.     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - hwWriteThreshold: Free space that makes the queue writable, 0 for  *
+*                       the whole queue.                                  *
+* Returns: True if successful, false otherwise.                          *
+****************************************************************************/
+bool queue_init_eventfd(byte_queue_t *ptObj, queue_size_t hwWriteThreshold)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+
+    queue_deinit_eventfd(ptObj);
+    int nReadFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int nWriteFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (nReadFd < 0 || nWriteFd < 0) {
+        if (nReadFd >= 0) {
+            close(nReadFd);
+        }
+        if (nWriteFd >= 0) {
+            close(nWriteFd);
+        }
+        return false;
+    }
+    if (0 == hwWriteThreshold || hwWriteThreshold > this.hwSize) {
+        hwWriteThreshold = this.hwSize;
+    }
+    this.hwWriteThreshold = hwWriteThreshold;
+    this.bReadArmed = true;
+    this.bWriteArmed = true;
+    this.nReadEventFd = nReadFd;
+    this.nWriteEventFd = nWriteFd;
+    if (!is_queue_empty(ptObj)) {  // Report what is already there
+        __queue_signal(&this.bReadArmed, nReadFd);
+    }
+    if (get_queue_available_count(ptObj) >= hwWriteThreshold) {
+        __queue_signal(&this.bWriteArmed, nWriteFd);
+    }
+    return true;
+}
+
+/****************************************************************************
+* Function: queue_deinit_eventfd                                          *
+* Description: Detaches and closes the eventfds of the byte queue.        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: True if eventfds were attached, false otherwise.              *
+****************************************************************************/
+bool queue_deinit_eventfd(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+
+    if (this.nReadEventFd < 0) {
+        return false;
+    }
+    close(this.nReadEventFd);
+    close(this.nWriteEventFd);
+    this.nReadEventFd = -1;
+    this.nWriteEventFd = -1;
+    this.bReadArmed = false;
+    this.bWriteArmed = false;
+    return true;
+}
+
+/****************************************************************************
+* Function: get_queue_read_eventfd                                        *
+* Description: Gets the eventfd the consumer waits on.                    *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: The eventfd, or -1 if none is attached.                        *
+****************************************************************************/
+int get_queue_read_eventfd(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    return ((byte_queue_t *)ptObj)->nReadEventFd;
+}
+
+/****************************************************************************
+* Function: get_queue_write_eventfd                                       *
+* Description: Gets the eventfd the producer waits on.                    *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: The eventfd, or -1 if none is attached.                        *
+****************************************************************************/
+int get_queue_write_eventfd(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    return ((byte_queue_t *)ptObj)->nWriteEventFd;
+}
+
+/****************************************************************************
+* Function: __queue_rearm                                                 *
+* Description: Clears an eventfd and arms its side again. The fence pairs *
+*              with the one in __queue_signal(), the caller checks the    *
+*              queue only after it.                                       *
+****************************************************************************/
+static void __queue_rearm(bool *pbArmed, int nFd)
+{
+    uint64_t dwCount;
+    while (read(nFd, &dwCount, sizeof(dwCount)) < 0 && EINTR == errno) {
+    }
+    __atomic_store_n(pbArmed, true, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/****************************************************************************
+* Function: queue_rearm_read_eventfd                                      *
+* Description: Consumer side: asks for a signal on the next enqueue.      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: True if the queue is empty, false if data is queued.          *
+****************************************************************************/
+bool queue_rearm_read_eventfd(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+
+    if (this.nReadEventFd >= 0) {
+        __queue_rearm(&this.bReadArmed, this.nReadEventFd);
+    }
+    return is_queue_empty(ptObj);
+}
+
+/****************************************************************************
+* Function: queue_rearm_write_eventfd                                     *
+* Description: Producer side: asks for a signal once hwWriteThreshold     *
+*              bytes are free.                                            *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+* Returns: True if less than the threshold is free, false otherwise.     *
+****************************************************************************/
+bool queue_rearm_write_eventfd(byte_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    byte_queue_t *ptThis = (byte_queue_t *)ptObj;
+
+    if (this.nWriteEventFd < 0) {
+        return false;
+    }
+    __queue_rearm(&this.bWriteArmed, this.nWriteEventFd);
+    return get_queue_available_count(ptObj) < this.hwWriteThreshold;
+}
+#endif
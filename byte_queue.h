@@ -22,6 +22,10 @@
 #include <string.h>
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #undef __CONNECT2
 #undef CONNECT2
 #undef __CONNECT3
@@ -48,7 +52,113 @@
                               8,7,6,5,4,3,2,1,0)
 #endif
 
+/*!
+ * \brief Width of every index and length of byte_queue_t. The default 16-bit
+ *        width keeps the footprint small on MCUs but limits a queue to 65535
+ *        bytes; define QUEUE_CFG_WIDE_INDEX to 1 to use 32-bit indices.
+ */
+#ifndef QUEUE_CFG_WIDE_INDEX
+#   define QUEUE_CFG_WIDE_INDEX        0
+#endif
+
+#if QUEUE_CFG_WIDE_INDEX
+typedef uint32_t queue_size_t;
+#else
+typedef uint16_t queue_size_t;
+#endif
+
+/*!
+ * \brief Cache line size used to keep state written by different cores apart.
+ *        0 keeps the structures packed, which suits MCUs without a data cache.
+ */
+#ifndef QUEUE_CFG_CACHE_LINE_SIZE
+#   if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#       define QUEUE_CFG_CACHE_LINE_SIZE    64
+#   else
+#       define QUEUE_CFG_CACHE_LINE_SIZE    0
+#   endif
+#endif
+
+#if QUEUE_CFG_CACHE_LINE_SIZE > 0
+#   define __QUEUE_CACHE_ALIGNED    __attribute__((aligned(QUEUE_CFG_CACHE_LINE_SIZE)))
+#else
+#   define __QUEUE_CACHE_ALIGNED
+#endif
+
+/*!
+ * \brief Set to 1 on Linux to add enqueue_bytes_timeout() and
+ *        dequeue_bytes_timeout(), which park the caller on a futex instead of
+ *        polling.
+ */
+#ifndef QUEUE_CFG_USE_FUTEX
+#   define QUEUE_CFG_USE_FUTEX         0
+#endif
+
+/*!
+ * \brief Set to 1 on Linux to add queue_init_mirror(), which maps the ring
+ *        buffer twice back-to-back so no region ever wraps.
+ */
+#ifndef QUEUE_CFG_USE_MIRROR
+#   define QUEUE_CFG_USE_MIRROR        0
+#endif
+
+/*!
+ * \brief Set to 1 on Linux to add queue_init_eventfd(), which lets an epoll
+ *        loop wait for a queue next to its sockets.
+ */
+#ifndef QUEUE_CFG_USE_EVENTFD
+#   define QUEUE_CFG_USE_EVENTFD       0
+#endif
+
+/*!
+ * \brief Set to 1 to keep traffic counters in every queue object, read them
+ *        with get_queue_stats(). Nothing is compiled in when left at 0.
+ */
+#ifndef QUEUE_CFG_STATS
+#   define QUEUE_CFG_STATS             0
+#endif
+
+/*!
+ * \brief Set to 1 (together with QUEUE_CFG_STATS) to also keep log2 latency
+ *        histograms of enqueue/dequeue calls. QUEUE_CFG_STATS_CLOCK() must
+ *        return a free-running 32-bit tick count, e.g. DWT->CYCCNT; hosts
+ *        default to CLOCK_MONOTONIC nanoseconds.
+ */
+#ifndef QUEUE_CFG_STATS_HISTOGRAM
+#   define QUEUE_CFG_STATS_HISTOGRAM   0
+#endif
+
 #ifndef safe_atom_code
+#if defined(__unix__) || defined(__APPLE__)
+/* Hosted build: there are no interrupts to mask, so a process-wide lock takes
+ * their place. The thread-local depth keeps nested sections working like
+ * nested PRIMASK save/restore does. */
+#include <pthread.h>
+#define __QUEUE_HOST_ATOM           1
+extern pthread_mutex_t g_tQueueAtomMutex;
+extern __thread uint32_t g_wQueueAtomDepth;
+
+static inline bool __queue_atom_enter(void)
+{
+    if (0 == g_wQueueAtomDepth++) {
+        pthread_mutex_lock(&g_tQueueAtomMutex);
+    }
+    return true;
+}
+
+static inline bool __queue_atom_leave(void)
+{
+    if (0 == --g_wQueueAtomDepth) {
+        pthread_mutex_unlock(&g_tQueueAtomMutex);
+    }
+    return false;
+}
+
+#define safe_atom_code()                                            \
+    for(  bool SAFE_NAME(temp) = __queue_atom_enter();           \
+        SAFE_NAME(temp);                                         \
+        SAFE_NAME(temp) = __queue_atom_leave())
+#else
 #include "cmsis_compiler.h"
 #define safe_atom_code()                                            \
     for(  uint32_t SAFE_NAME(temp) =                             \
@@ -58,6 +168,7 @@
         SAFE_NAME(temp3)++ == NULL;                      \
         __set_PRIMASK(SAFE_NAME(temp)))
 #endif
+#endif
 
 
 #define __DEQUEUE_0( __QUEUE, __ADDR)                                \
@@ -106,7 +217,11 @@
  *
  * \return the address of queue item
  *
- * \details Here is an example:
+ * \details When __size is a power of two the queue runs on free-running head
+ *          and tail counters with mask indexing: the length is tail - head,
+ *          and full and empty need no extra state.
+ *
+ *          Here is an example:
     E.g.
     \code
         static uint8_t s_hwQueueBuffer[100];
@@ -234,29 +349,134 @@ if (!(EXPR))                                                                   \
     while (1);                                                                 \
 }
 
+#if QUEUE_CFG_STATS
+#if UINTPTR_MAX > 0xFFFFFFFFu
+typedef uint64_t queue_stats_cnt_t;
+#else
+typedef uint32_t queue_stats_cnt_t;     /* wraps, compare differences */
+#endif
+
+#define QUEUE_STATS_HISTOGRAM_BUCKETS   32
+
+/*!
+ * \brief Traffic counters of one queue, see get_queue_stats().
+ */
+typedef struct queue_stats_t {
+    queue_stats_cnt_t dwEnqueueOps;     /* calls that stored at least 1 byte */
+    queue_stats_cnt_t dwEnqueueBytes;
+    queue_stats_cnt_t dwDequeueOps;     /* calls that removed at least 1 byte */
+    queue_stats_cnt_t dwDequeueBytes;
+    queue_stats_cnt_t dwOverwrittenBytes;   /* dropped by cover mode */
+    queue_stats_cnt_t dwTruncatedBytes;     /* offered but not stored */
+    queue_stats_cnt_t dwBusyRejects;        /* calls refused by bMutex */
+    queue_size_t hwHighWater;           /* largest fill level seen */
+#if QUEUE_CFG_STATS_HISTOGRAM
+    /* bucket n counts calls that took [2^(n-1), 2^n) clock ticks */
+    uint32_t wEnqueueLatency[QUEUE_STATS_HISTOGRAM_BUCKETS];
+    uint32_t wDequeueLatency[QUEUE_STATS_HISTOGRAM_BUCKETS];
+#endif
+} queue_stats_t;
+#endif
+
 typedef struct byte_queue_t {
+    /* configuration and the state of the locked (non power-of-two) mode,
+     * which both sides write under bMutex anyway */
     uint8_t *pchBuffer;
-    uint16_t hwSize;
-    uint16_t hwHead;
-    uint16_t hwTail;
-    uint16_t hwLength;
-    uint16_t hwPeek;
-    uint16_t hwPeekLength;
+    queue_size_t hwSize;
+    queue_size_t hwLength;
+    queue_size_t hwPeekLength;
 	bool bMutex;
     bool bIsCover;
+    bool bIsSPSC;
+    bool bIsPow2;
+    bool bIsMessage;                    /* cover mode drops whole messages */
+#if QUEUE_CFG_USE_MIRROR
+    bool bIsMirror;                     /* pchBuffer is mapped twice */
+#endif
+#if QUEUE_CFG_USE_FUTEX
+    /* futex words bumped only while a thread is parked on them */
+    uint32_t wReadEvent;
+    uint32_t wWriteEvent;
+    uint32_t wReadWaiters;
+    uint32_t wWriteWaiters;
+#endif
+#if QUEUE_CFG_USE_EVENTFD
+    /* an armed side gets one eventfd write, then nothing until it re-arms */
+    int nReadEventFd;
+    int nWriteEventFd;
+    queue_size_t hwWriteThreshold;
+    bool bReadArmed;
+    bool bWriteArmed;
+#endif
+    /* producer side. The free-running byte counters are used in SPSC and
+     * power-of-two mode instead of hwLength; each side keeps the last value
+     * it saw of the other side's counter and only reads the other side's
+     * cache line again when that view says full or empty. */
+    __QUEUE_CACHE_ALIGNED
+    queue_size_t hwTail;
+    queue_size_t hwTailCount;           /* published by the producer */
+    queue_size_t hwHeadCache;           /* producer's view of hwHeadCount */
+    /* consumer side */
+    __QUEUE_CACHE_ALIGNED
+    queue_size_t hwHead;
+    queue_size_t hwPeek;
+    queue_size_t hwHeadCount;           /* published by the consumer */
+    queue_size_t hwPeekCount;           /* private to the consumer */
+    queue_size_t hwTailCache;           /* consumer's view of hwTailCount */
+#if QUEUE_CFG_STATS
+    __QUEUE_CACHE_ALIGNED
+    queue_stats_t tStats;
+#endif
 } byte_queue_t;
 
+/*!
+ * \brief A contiguous region of the ring buffer handed out by the zero-copy
+ *        API. A wrapped region is described by two spans.
+ */
+typedef struct queue_span_t {
+    uint8_t *pchBuffer;
+    queue_size_t hwLength;
+} queue_span_t;
+
+/*!
+ * \brief One caller buffer of a scatter/gather transfer.
+ */
+typedef struct queue_iovec_t {
+    void *pBuffer;
+    queue_size_t hwLength;
+} queue_iovec_t;
+
+extern
+byte_queue_t *queue_init_byte(byte_queue_t *ptObj, void *pBuffer, queue_size_t hwItemSize, bool bIsCover);
+
+/*!
+ * \brief Initialize the queue object in lock-free single-producer/single-consumer
+ *        mode.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pBuffer address of ring buffer var
+ * \param[in] hwItemSize size of the ring buffer in bytes.
+ *
+ * \return the address of queue item
+ *
+ * \details In this mode the producer owns hwTail, the consumer owns hwHead and
+ *          the peek cursor, and the two sides only exchange the free-running
+ *          byte counters through acquire/release atomics. safe_atom_code() and
+ *          bMutex are never used, so a call never fails because the other side
+ *          is busy. Exactly one context may enqueue and exactly one context may
+ *          dequeue/peek. Cover mode is not supported.
+ */
 extern
-byte_queue_t *queue_init_byte(byte_queue_t *ptObj, void *pBuffer, uint16_t hwItemSize, bool bIsCover);
+byte_queue_t *queue_init_spsc(byte_queue_t *ptObj, void *pBuffer, queue_size_t hwItemSize);
 
 extern
 bool reset_queue(byte_queue_t *ptObj);
 
 extern
-uint16_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength);
+queue_size_t enqueue_bytes(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength);
 
 extern
-uint16_t dequeue_bytes(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength);
+queue_size_t dequeue_bytes(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength);
 
 extern
 bool is_queue_empty(byte_queue_t *ptQueue);
@@ -265,7 +485,7 @@ extern
 bool is_peek_empty(byte_queue_t *ptObj);
 
 extern
-uint16_t peek_bytes_queue(byte_queue_t *ptObj, void *pDate, uint16_t hwDataLength);
+queue_size_t peek_bytes_queue(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength);
 
 extern
 bool reset_peek(byte_queue_t *ptQueue);
@@ -274,15 +494,430 @@ extern
 bool get_all_peeked(byte_queue_t *ptQueue);
 
 extern
-uint16_t get_peek_status(byte_queue_t *ptQueue);
+queue_size_t get_peek_status(byte_queue_t *ptQueue);
+
+extern
+bool restore_peek_status(byte_queue_t *ptQueue, queue_size_t hwCount);
+
+extern
+queue_size_t get_queue_count(byte_queue_t *ptObj);
+
+extern
+queue_size_t get_queue_available_count(byte_queue_t *ptObj);
+
+/*!
+ * \brief Reserve the free space of the ring buffer for in-place writing.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[out] tSpan two spans receiving the writable regions, the second one
+ *             is empty unless the free space wraps at the end of the buffer.
+ *
+ * \return Return the total writable size, 0 if the queue is full or busy.
+ *
+ * \details The queue stays locked until enqueue_commit() is called, which
+ *          must follow every reserve that returned a non-zero size. In cover
+ *          mode only the free space is handed out, nothing is overwritten.
+    E.g. Let a driver write straight into the ring buffer
+    \code
+        queue_span_t tSpan[2];
+        if (enqueue_reserve(&my_queue, tSpan)) {
+            queue_size_t hwCount = uart_read(tSpan[0].pchBuffer, tSpan[0].hwLength);
+            enqueue_commit(&my_queue, hwCount);
+        }
+    \endcode
+ */
+extern
+queue_size_t enqueue_reserve(byte_queue_t *ptObj, queue_span_t tSpan[2]);
+
+/*!
+ * \brief Publish the first hwDataLength bytes of the reserved space.
+ *
+ * \return Return the data size committed into the ring buffer.
+ */
+extern
+queue_size_t enqueue_commit(byte_queue_t *ptObj, queue_size_t hwDataLength);
+
+/*!
+ * \brief Expose the queued data of the ring buffer for in-place reading.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[out] tSpan two spans receiving the readable regions, the second one
+ *             is empty unless the data wraps at the end of the buffer.
+ *
+ * \return Return the total readable size, 0 if the queue is empty or busy.
+ *
+ * \details The queue stays locked until dequeue_release() is called, which
+ *          must follow every acquire that returned a non-zero size.
+ */
+extern
+queue_size_t dequeue_acquire(byte_queue_t *ptObj, queue_span_t tSpan[2]);
+
+/*!
+ * \brief Drop the first hwDataLength bytes of the acquired data and reset the
+ *        peek cursor, exactly like dequeue_bytes() does.
+ *
+ * \return Return the data size removed from the ring buffer.
+ */
+extern
+queue_size_t dequeue_release(byte_queue_t *ptObj, queue_size_t hwDataLength);
 
+/*!
+ * \brief Put several buffers into the ring buffer as one unit.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] ptVector buffers to be enqueued, in order.
+ * \param[in] hwVectorCount number of buffers.
+ *
+ * \return Return the total size of the buffers, or 0 if they were not stored.
+ *
+ * \details The space is checked and the tail is moved once for the whole
+ *          vector, so another producer can never interleave and a record is
+ *          either stored completely or not at all. In cover mode old data is
+ *          dropped to make room.
+    E.g.
+    \code
+        queue_iovec_t tRecord[] = {
+            {&tHeader, sizeof(tHeader)},
+            {pchPayload, hwPayloadSize},
+            {&hwCrc, sizeof(hwCrc)},
+        };
+        enqueue_bytes_v(&my_queue, tRecord, 3);
+    \endcode
+ */
 extern
-bool restore_peek_status(byte_queue_t *ptQueue, uint16_t hwCount);
+queue_size_t enqueue_bytes_v(byte_queue_t *ptObj, const queue_iovec_t *ptVector, uint16_t hwVectorCount);
 
+/*!
+ * \brief Get data from the ring buffer into several buffers as one unit.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] ptVector buffers to be filled, in order.
+ * \param[in] hwVectorCount number of buffers.
+ *
+ * \return Return the total size of the buffers, or 0 if the queue holds less.
+ */
 extern
-uint16_t get_queue_count(byte_queue_t *ptObj);
+queue_size_t dequeue_bytes_v(byte_queue_t *ptObj, const queue_iovec_t *ptVector, uint16_t hwVectorCount);
 
+/*!
+ * \brief Initialize a queue that carries length-prefixed messages.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pBuffer address of ring buffer var
+ * \param[in] hwItemSize size of the ring buffer in bytes.
+ * \param[in] bIsCover whether old messages are discarded when the queue is full.
+ *
+ * \return the address of queue item
+ *
+ * \details Same as queue_init(), except that cover mode discards whole
+ *          messages instead of bytes, so the head never lands inside a
+ *          message. A queue set up with queue_init() or queue_init_spsc()
+ *          can carry messages as well as long as it never overwrites.
+ *          Mixing message and byte access on one queue corrupts the framing.
+ */
 extern
-uint16_t get_queue_available_count(byte_queue_t *ptObj);
+byte_queue_t *queue_init_message(byte_queue_t *ptObj, void *pBuffer, queue_size_t hwItemSize, bool bIsCover);
+
+/*!
+ * \brief Put one message into the ring buffer.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pDate address of the message.
+ * \param[in] hwDataLength length of the message, at least 1 byte.
+ *
+ * \return Return hwDataLength, or 0 if the message was not stored.
+ *
+ * \details The message occupies sizeof(queue_size_t) + hwDataLength bytes and
+ *          is stored whole or rejected, it is never truncated.
+    E.g.
+    \code
+        static uint8_t s_chBuffer[256];
+        static byte_queue_t my_queue;
+        queue_init_message(&my_queue, s_chBuffer, sizeof(s_chBuffer), true);
+        enqueue_message(&my_queue, chFrame, hwFrameSize);
+
+        uint8_t chRxFrame[64];
+        if(get_queue_message_size(&my_queue) <= sizeof(chRxFrame)) {
+            hwFrameSize = dequeue_message(&my_queue, chRxFrame, sizeof(chRxFrame));
+        }
+    \endcode
+ */
+extern
+queue_size_t enqueue_message(byte_queue_t *ptObj, const void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Get exactly one message from the ring buffer.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pDate buffer receiving the message.
+ * \param[in] hwBufferSize size of that buffer.
+ *
+ * \return Return the length of the message, or 0 if the queue is empty or the
+ *         message is larger than hwBufferSize, in which case it stays queued.
+ */
+extern
+queue_size_t dequeue_message(byte_queue_t *ptObj, void *pDate, queue_size_t hwBufferSize);
+
+/*!
+ * \brief Get the length of the next message without removing it.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ *
+ * \return Return the length of the next message, or 0 if there is none.
+ */
+extern
+queue_size_t get_queue_message_size(byte_queue_t *ptObj);
+
+/*!
+ * \brief Find the first occurrence of a byte in the queued data.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] chByte the byte to look for.
+ * \param[out] phwOffset receives its offset from the oldest queued byte.
+ *
+ * \return Return true if the byte was found, false if it is not queued or the
+ *         queue is busy.
+ *
+ * \details The ring buffer is searched in place with memchr(), one call per
+ *          contiguous region, instead of peeking byte by byte. Nothing is
+ *          removed and the peek cursor is left alone.
+ */
+extern
+bool queue_find_byte(byte_queue_t *ptObj, uint8_t chByte, queue_size_t *phwOffset);
+
+/*!
+ * \brief Find the first occurrence of a byte sequence in the queued data.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pPattern address of the sequence.
+ * \param[in] hwPatternLength length of the sequence, at least 1 byte.
+ * \param[out] phwOffset receives the offset of its first byte from the oldest
+ *             queued byte.
+ *
+ * \return Return true if the sequence was found, false otherwise.
+ *
+ * \details A match may straddle the end of the ring buffer.
+ */
+extern
+bool queue_find_pattern(byte_queue_t *ptObj, const void *pPattern, queue_size_t hwPatternLength, queue_size_t *phwOffset);
+
+/*!
+ * \brief Get everything up to and including a delimiter from the ring buffer.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] chDelimiter the byte terminating a record, e.g. '\n'.
+ * \param[in] pDate buffer receiving the record.
+ * \param[in] hwBufferSize size of that buffer.
+ *
+ * \return Return the record length including the delimiter, or 0 if no
+ *         delimiter is queued within the first hwBufferSize bytes, in which
+ *         case nothing is removed.
+ *
+ * \details A record longer than hwBufferSize stays queued, use
+ *          queue_find_byte() and dequeue_bytes() to get rid of it.
+    E.g.
+    \code
+        char chLine[80];
+        queue_size_t hwLength;
+        while((hwLength = dequeue_until(&my_queue, '\n', chLine, sizeof(chLine))) > 0) {
+            handle_line(chLine, hwLength);
+        }
+    \endcode
+ */
+extern
+queue_size_t dequeue_until(byte_queue_t *ptObj, uint8_t chDelimiter, void *pDate, queue_size_t hwBufferSize);
+
+#if QUEUE_CFG_USE_MIRROR
+/*!
+ * \brief Initialize the queue object on a double-mapped buffer.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] hwItemSize size of the ring buffer in bytes, a multiple of the
+ *            page size.
+ * \param[in] bIsCover whether old data is overwritten when the queue is full.
+ *
+ * \return the address of queue item, or NULL if the buffer can not be mapped.
+ *
+ * \details The buffer is a memfd mapped twice in a row, so any region of up to
+ *          hwItemSize bytes is virtually contiguous: every copy is a single
+ *          memcpy and the span API always returns everything in tSpan[0],
+ *          which lets a consumer parse records in place.
+    E.g.
+    \code
+        static byte_queue_t my_queue;
+        queue_init_mirror(&my_queue, 16384, false);
+        ...
+        queue_span_t tSpan[2];
+        queue_size_t hwLength = dequeue_acquire(&my_queue, tSpan);
+        hwLength = parse(tSpan[0].pchBuffer, hwLength);
+        dequeue_release(&my_queue, hwLength);
+        ...
+        queue_deinit_mirror(&my_queue);
+    \endcode
+ */
+extern
+byte_queue_t *queue_init_mirror(byte_queue_t *ptObj, queue_size_t hwItemSize, bool bIsCover);
+
+/*!
+ * \brief SPSC counterpart of queue_init_mirror(), see queue_init_spsc().
+ */
+extern
+byte_queue_t *queue_init_spsc_mirror(byte_queue_t *ptObj, queue_size_t hwItemSize);
+
+/*!
+ * \brief Release the buffer of a queue set up by queue_init_mirror() or
+ *        queue_init_spsc_mirror().
+ *
+ * \param[in] ptObj pointer to the queue object.
+ *
+ * \return false if the queue was not double-mapped.
+ */
+extern
+bool queue_deinit_mirror(byte_queue_t *ptObj);
+#endif
+
+#if QUEUE_CFG_USE_FUTEX
+/*!
+ * \brief Put a block of data into the ring buffer, waiting for free space.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pDate address to the data buffer
+ * \param[in] hwDataLength size of the data in bytes.
+ * \param[in] nTimeoutMs time limit in milliseconds, negative to wait forever.
+ *
+ * \return Return the data size we put into the ring buffer, which is less
+ *         than hwDataLength only if the time limit passed.
+ *
+ * \details A full queue parks the caller on a futex until a consumer frees
+ *          space; a busy bMutex only makes it yield and retry. Consumers only
+ *          make the wake-up syscall while a thread is actually parked.
+ */
+extern
+queue_size_t enqueue_bytes_timeout(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength, int32_t nTimeoutMs);
+
+/*!
+ * \brief Get a block of data from the ring buffer, waiting for the data.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pDate address to the data buffer
+ * \param[in] hwDataLength size of the data in bytes.
+ * \param[in] nTimeoutMs time limit in milliseconds, negative to wait forever.
+ *
+ * \return Return the data size we read from the ring buffer, which is less
+ *         than hwDataLength only if the time limit passed.
+ */
+extern
+queue_size_t dequeue_bytes_timeout(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength, int32_t nTimeoutMs);
+
+#define enqueue_bytes_wait(__QUEUE, __ADDR, __LENGTH)                          \
+    enqueue_bytes_timeout((__QUEUE), (__ADDR), (__LENGTH), -1)
+
+#define dequeue_bytes_wait(__QUEUE, __ADDR, __LENGTH)                          \
+    dequeue_bytes_timeout((__QUEUE), (__ADDR), (__LENGTH), -1)
+#endif
+
+#if QUEUE_CFG_USE_EVENTFD
+/*!
+ * \brief Attach a pair of eventfds to the queue for epoll style waiting.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] hwWriteThreshold free space in bytes that makes the queue
+ *            writable again, 0 for the full queue size.
+ *
+ * \return false if the eventfds could not be created.
+ *
+ * \details get_queue_read_eventfd() becomes readable when data arrives in a
+ *          queue the consumer had found empty, get_queue_write_eventfd() when
+ *          at least hwWriteThreshold bytes are free again after the producer
+ *          had found too little space. Each side is signalled once and then
+ *          stays quiet until it re-arms, so a burst of enqueues costs one
+ *          eventfd write instead of one per call. Call it before the queue
+ *          is shared between threads.
+    E.g.
+    \code
+        queue_init_eventfd(&s_tRxQueue, 0);
+        epoll_add(nEpoll, get_queue_read_eventfd(&s_tRxQueue), EPOLLIN);
+        ...
+        // EPOLLIN on the read eventfd
+        do {
+            while ((hwLength = dequeue_bytes(&s_tRxQueue, chBuf, sizeof(chBuf))) > 0) {
+                handle(chBuf, hwLength);
+            }
+        } while (!queue_rearm_read_eventfd(&s_tRxQueue));
+    \endcode
+ */
+extern
+bool queue_init_eventfd(byte_queue_t *ptObj, queue_size_t hwWriteThreshold);
+
+/*!
+ * \brief Detach and close the eventfds of the queue.
+ */
+extern
+bool queue_deinit_eventfd(byte_queue_t *ptObj);
+
+/*!
+ * \brief Get the eventfd signalling data for the consumer, -1 if none.
+ */
+extern
+int get_queue_read_eventfd(byte_queue_t *ptObj);
+
+/*!
+ * \brief Get the eventfd signalling free space for the producer, -1 if none.
+ */
+extern
+int get_queue_write_eventfd(byte_queue_t *ptObj);
+
+/*!
+ * \brief Consumer side: clear the read eventfd and ask for the next signal.
+ *
+ * \return true if the queue is empty and the caller may go back to waiting,
+ *         false if data is queued and the caller should keep reading.
+ */
+extern
+bool queue_rearm_read_eventfd(byte_queue_t *ptObj);
+
+/*!
+ * \brief Producer side: clear the write eventfd and ask for the next signal.
+ *
+ * \return true if less than the threshold is free and the caller may go back
+ *         to waiting, false if it can keep writing.
+ */
+extern
+bool queue_rearm_write_eventfd(byte_queue_t *ptObj);
+#endif
+
+#if QUEUE_CFG_STATS
+/*!
+ * \brief Copy the traffic counters of a queue.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[out] ptStats receives the counters.
+ *
+ * \return always true.
+ *
+ * \details Each field is read atomically but the fields are not read as one
+ *          unit, so a snapshot taken while other threads use the queue may
+ *          mix counts from before and after a call. Byte counts include the
+ *          length prefix of messages. The *_timeout() calls are counted as
+ *          the enqueue_bytes()/dequeue_bytes() attempts they are made of.
+ */
+extern
+bool get_queue_stats(byte_queue_t *ptObj, queue_stats_t *ptStats);
+
+/*!
+ * \brief Zero the traffic counters of a queue. Counts made by calls that
+ *        run concurrently may survive the reset.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ *
+ * \return always true.
+ */
+extern
+bool reset_queue_stats(byte_queue_t *ptObj);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* QUEUE_QUEUE_H_ */
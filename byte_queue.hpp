@@ -0,0 +1,329 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_BYTE_QUEUE_HPP_
+#define QUEUE_BYTE_QUEUE_HPP_
+#include "byte_queue.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+/*!
+ * \brief C++ layer over byte_queue_t. Needs C++17; the window functions
+ *        returning std::span need C++20.
+ */
+namespace wl {
+
+/*!
+ * \brief Single-producer/single-consumer ring of N objects of type T, stored
+ *        inside the ring object.
+ *
+ * \details The slots are the buffer of a queue_init_spsc() queue that only
+ *          ever moves whole sizeof(T) records, so a slot never wraps and the
+ *          zero-copy enqueue_reserve()/dequeue_acquire() spans point straight
+ *          at it. Objects are constructed in place and moved out, so types
+ *          that own memory pass through without a deep copy; objects left
+ *          in the ring are destroyed with it. One thread may push while
+ *          another pops.
+    E.g.
+    \code
+        static wl::ring<std::string, 64> s_tLines;
+        s_tLines.try_emplace(16, '-');
+        s_tLines.try_push(std::move(tLine));
+        std::string tOut;
+        while (s_tLines.try_pop(tOut)) {
+            ...
+        }
+    \endcode
+ */
+template <typename T, std::size_t N>
+class ring {
+    static_assert(N > 0, "a ring needs at least one slot");
+    static_assert(N * sizeof(T) <= static_cast<queue_size_t>(~static_cast<queue_size_t>(0)),
+                  "N * sizeof(T) does not fit queue_size_t, see QUEUE_CFG_WIDE_INDEX");
+
+public:
+    using value_type = T;
+
+    ring() noexcept
+    {
+        queue_init_spsc(&m_tQueue, m_chStorage, static_cast<queue_size_t>(sizeof(m_chStorage)));
+    }
+
+    ~ring()
+    {
+        clear();
+    }
+
+    ring(const ring &) = delete;
+    ring &operator=(const ring &) = delete;
+
+    static constexpr std::size_t capacity() noexcept
+    {
+        return N;
+    }
+
+    std::size_t size() noexcept
+    {
+        return get_queue_count(&m_tQueue) / sizeof(T);
+    }
+
+    bool empty() noexcept
+    {
+        return is_queue_empty(&m_tQueue);
+    }
+
+    /*!
+     * \brief Construct an object in the next free slot.
+     * \return false if the ring is full; nothing is constructed then.
+     */
+    template <typename... Args>
+    bool try_emplace(Args &&...args) noexcept(std::is_nothrow_constructible<T, Args...>::value)
+    {
+        queue_span_t tSpan[2];
+        if (enqueue_reserve(&m_tQueue, tSpan) < sizeof(T)) {
+            return false;
+        }
+        commit_guard tGuard{&m_tQueue, 0};
+        ::new (static_cast<void *>(tSpan[0].pchBuffer)) T(std::forward<Args>(args)...);
+        tGuard.hwLength = sizeof(T);
+        return true;
+    }
+
+    bool try_push(T &&tItem) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        return try_emplace(std::move(tItem));
+    }
+
+    bool try_push(const T &tItem) noexcept(std::is_nothrow_copy_constructible<T>::value)
+    {
+        return try_emplace(tItem);
+    }
+
+    /*!
+     * \brief Move the oldest object into tItem and destroy the slot.
+     * \return false if the ring is empty; tItem is untouched then.
+     */
+    bool try_pop(T &tItem) noexcept(std::is_nothrow_move_assignable<T>::value)
+    {
+        queue_span_t tSpan[2];
+        if (dequeue_acquire(&m_tQueue, tSpan) < sizeof(T)) {
+            return false;
+        }
+        release_guard tGuard{this, 0};
+        tItem = std::move(*slot(tSpan[0].pchBuffer));
+        tGuard.wCount = 1;
+        return true;
+    }
+
+    /*!
+     * \brief Destroy every object in the ring. Only the consumer may call it.
+     */
+    void clear() noexcept
+    {
+        queue_span_t tSpan[2];
+        while (dequeue_acquire(&m_tQueue, tSpan) >= sizeof(T)) {
+            release(tSpan[0].hwLength / sizeof(T));
+        }
+    }
+
+#if defined(__cpp_lib_span)
+    /*!
+     * \brief The oldest objects that are contiguous in memory. Hand the ones
+     *        consumed to release(), which destroys them.
+     */
+    std::span<T> read_window() noexcept
+    {
+        queue_span_t tSpan[2];
+        dequeue_acquire(&m_tQueue, tSpan);
+        return std::span<T>(slot(tSpan[0].pchBuffer), tSpan[0].hwLength / sizeof(T));
+    }
+
+    /*!
+     * \brief Free slots that are contiguous in memory, for trivial types
+     *        only. Publish the ones written with commit().
+     */
+    std::span<T> write_window() noexcept
+    {
+        static_assert(std::is_trivially_copyable<T>::value
+                   && std::is_trivially_default_constructible<T>::value,
+                      "write_window() hands out raw slots, use try_emplace()");
+        queue_span_t tSpan[2];
+        enqueue_reserve(&m_tQueue, tSpan);
+        return std::span<T>(reinterpret_cast<T *>(tSpan[0].pchBuffer), tSpan[0].hwLength / sizeof(T));
+    }
+
+    std::size_t commit(std::size_t wCount) noexcept
+    {
+        return enqueue_commit(&m_tQueue, static_cast<queue_size_t>(wCount * sizeof(T))) / sizeof(T);
+    }
+#endif
+
+    /*!
+     * \brief Destroy the wCount oldest objects, e.g. after read_window().
+     */
+    std::size_t release(std::size_t wCount) noexcept
+    {
+        queue_span_t tSpan[2];
+        std::size_t wLength = dequeue_acquire(&m_tQueue, tSpan);
+        if (wCount > wLength / sizeof(T)) {
+            wCount = wLength / sizeof(T);
+        }
+        for (std::size_t i = 0; i < wCount; i++) {
+            uint8_t *pchSlot = (i * sizeof(T) < tSpan[0].hwLength)
+                             ? tSpan[0].pchBuffer + i * sizeof(T)
+                             : tSpan[1].pchBuffer + (i * sizeof(T) - tSpan[0].hwLength);
+            slot(pchSlot)->~T();
+        }
+        return dequeue_release(&m_tQueue, static_cast<queue_size_t>(wCount * sizeof(T))) / sizeof(T);
+    }
+
+    byte_queue_t *native_handle() noexcept
+    {
+        return &m_tQueue;
+    }
+
+private:
+    struct commit_guard {
+        byte_queue_t *ptQueue;
+        queue_size_t hwLength;
+        ~commit_guard()
+        {
+            enqueue_commit(ptQueue, hwLength);
+        }
+    };
+
+    struct release_guard {
+        ring *ptRing;
+        std::size_t wCount;
+        ~release_guard()
+        {
+            ptRing->release(wCount);
+        }
+    };
+
+    static T *slot(uint8_t *pchSlot) noexcept
+    {
+        return std::launder(reinterpret_cast<T *>(pchSlot));
+    }
+
+    byte_queue_t m_tQueue;
+    alignas(T) uint8_t m_chStorage[N * sizeof(T)];
+};
+
+/*!
+ * \brief byte_queue_t over a caller supplied buffer, with the byte-stream
+ *        API as member functions.
+ *
+ * \details The default mode is queue_init_spsc(); pass locked to get the
+ *          queue_init_byte() mode that any number of threads may share.
+ */
+class byte_ring {
+public:
+    enum class mode { spsc, locked, cover };
+
+    byte_ring(void *pBuffer, queue_size_t hwSize, mode tMode = mode::spsc) noexcept
+    {
+        if (mode::spsc == tMode) {
+            queue_init_spsc(&m_tQueue, pBuffer, hwSize);
+        } else {
+            queue_init_byte(&m_tQueue, pBuffer, hwSize, mode::cover == tMode);
+        }
+    }
+
+    byte_ring(const byte_ring &) = delete;
+    byte_ring &operator=(const byte_ring &) = delete;
+
+    std::size_t capacity() const noexcept
+    {
+        return m_tQueue.hwSize;
+    }
+
+    std::size_t size() noexcept
+    {
+        return get_queue_count(&m_tQueue);
+    }
+
+    bool empty() noexcept
+    {
+        return is_queue_empty(&m_tQueue);
+    }
+
+    std::size_t write(const void *pData, queue_size_t hwLength) noexcept
+    {
+        return enqueue_bytes(&m_tQueue, const_cast<void *>(pData), hwLength);
+    }
+
+    std::size_t read(void *pData, queue_size_t hwLength) noexcept
+    {
+        return dequeue_bytes(&m_tQueue, pData, hwLength);
+    }
+
+    std::size_t peek(void *pData, queue_size_t hwLength) noexcept
+    {
+        return peek_bytes_queue(&m_tQueue, pData, hwLength);
+    }
+
+#if defined(__cpp_lib_span)
+    /*!
+     * \brief Contiguous free space; publish what was written with commit().
+     *        In locked mode the queue stays locked until then.
+     */
+    std::span<std::byte> write_window() noexcept
+    {
+        queue_span_t tSpan[2];
+        enqueue_reserve(&m_tQueue, tSpan);
+        return std::span<std::byte>(reinterpret_cast<std::byte *>(tSpan[0].pchBuffer), tSpan[0].hwLength);
+    }
+
+    /*!
+     * \brief Contiguous queued data; drop what was consumed with release().
+     *        In locked mode the queue stays locked until then.
+     */
+    std::span<const std::byte> read_window() noexcept
+    {
+        queue_span_t tSpan[2];
+        dequeue_acquire(&m_tQueue, tSpan);
+        return std::span<const std::byte>(reinterpret_cast<const std::byte *>(tSpan[0].pchBuffer), tSpan[0].hwLength);
+    }
+#endif
+
+    std::size_t commit(queue_size_t hwLength) noexcept
+    {
+        return enqueue_commit(&m_tQueue, hwLength);
+    }
+
+    std::size_t release(queue_size_t hwLength) noexcept
+    {
+        return dequeue_release(&m_tQueue, hwLength);
+    }
+
+    byte_queue_t *native_handle() noexcept
+    {
+        return &m_tQueue;
+    }
+
+private:
+    byte_queue_t m_tQueue;
+};
+
+} // namespace wl
+
+#endif /* QUEUE_BYTE_QUEUE_HPP_ */
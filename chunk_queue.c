@@ -0,0 +1,342 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "chunk_queue.h"
+#undef this
+#define this        (*ptThis)
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#   define CHUNK_POOL_INDEX_BITS    32
+#else
+#   define CHUNK_POOL_INDEX_BITS    16
+#endif
+#define CHUNK_POOL_INDEX_MASK       (((chunk_pool_word_t)1 << CHUNK_POOL_INDEX_BITS) - 1)
+
+/* index + 1 of the top segment, 0 for an empty list */
+#define __chunk_word_index(__WORD)                                             \
+    ((uint32_t)((__WORD) & CHUNK_POOL_INDEX_MASK))
+
+/* the next version of __WORD with __INDEX on top */
+#define __chunk_word_next(__WORD, __INDEX)                                     \
+    (((((__WORD) >> CHUNK_POOL_INDEX_BITS) + 1) << CHUNK_POOL_INDEX_BITS)      \
+        | (chunk_pool_word_t)(__INDEX))
+
+/****************************************************************************
+* Function: chunk_pool_init                                               *
+* Description: Initializes a segment pool. Segments are only allocated    *
+*              when a queue first needs them.                             *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_pool_t object to be initialized.       *
+*   - hwSegmentSize: Payload bytes per segment.                           *
+*   - wMaxSegments: Cap on the number of segments.                        *
+* Returns: Pointer to the initialized chunk_pool_t object or NULL.       *
+****************************************************************************/
+chunk_pool_t *chunk_pool_init(chunk_pool_t *ptObj, queue_size_t hwSegmentSize, uint32_t wMaxSegments)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_pool_t *ptThis = (chunk_pool_t *)ptObj;
+
+    if (0 == hwSegmentSize || 0 == wMaxSegments || wMaxSegments >= CHUNK_POOL_INDEX_MASK) {
+        return NULL;
+    }
+    size_t tTableSize = sizeof(chunk_segment_t *) * wMaxSegments;
+    this.pptSegment = QUEUE_CFG_CHUNK_ALLOC(_Alignof(chunk_segment_t *), tTableSize);
+    if (NULL == this.pptSegment) {
+        return NULL;
+    }
+    memset(this.pptSegment, 0, tTableSize);
+    this.wMaxSegments = wMaxSegments;
+    this.hwSegmentSize = hwSegmentSize;
+    this.wAllocated = 0;
+    this.tFreeHead = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: chunk_pool_deinit                                             *
+* Description: Frees every segment of the pool.                           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_pool_t object.                         *
+* Returns: True if successful, false otherwise.                          *
+****************************************************************************/
+bool chunk_pool_deinit(chunk_pool_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_pool_t *ptThis = (chunk_pool_t *)ptObj;
+
+    if (NULL == this.pptSegment) {
+        return false;
+    }
+    for (uint32_t i = 0; i < this.wAllocated; i++) {
+        if (NULL != this.pptSegment[i]) {
+            QUEUE_CFG_CHUNK_FREE(this.pptSegment[i]);
+        }
+    }
+    QUEUE_CFG_CHUNK_FREE(this.pptSegment);
+    this.pptSegment = NULL;
+    this.wAllocated = 0;
+    this.tFreeHead = 0;
+    return true;
+}
+
+/****************************************************************************
+* Function: get_chunk_pool_allocated                                      *
+* Description: Gets the number of segments allocated so far.              *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_pool_t object.                         *
+* Returns: Number of segments, in use or free.                            *
+****************************************************************************/
+uint32_t get_chunk_pool_allocated(chunk_pool_t *ptObj)
+{
+    assert(NULL != ptObj);
+    return __atomic_load_n(&ptObj->wAllocated, __ATOMIC_RELAXED);
+}
+
+/****************************************************************************
+* Function: __chunk_pool_get                                              *
+* Description: Takes a segment off the free list (a Treiber stack whose   *
+*              head carries a version tag against ABA), or allocates a    *
+*              new one while the pool is below its cap.                   *
+* Returns: An empty segment, or NULL if the pool is exhausted.           *
+****************************************************************************/
+static chunk_segment_t *__chunk_pool_get(chunk_pool_t *ptThis)
+{
+    chunk_segment_t *ptSegment;
+    chunk_pool_word_t tHead = __atomic_load_n(&this.tFreeHead, __ATOMIC_ACQUIRE);
+    while (0 != __chunk_word_index(tHead)) {
+        ptSegment = this.pptSegment[__chunk_word_index(tHead) - 1];
+        /* may already be stale, the tag then makes the CAS fail */
+        uint32_t wNext = __atomic_load_n(&ptSegment->wFreeNext, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&this.tFreeHead, &tHead, __chunk_word_next(tHead, wNext),
+                                        false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return ptSegment;
+        }
+    }
+    uint32_t wIndex = __atomic_load_n(&this.wAllocated, __ATOMIC_RELAXED);
+    do {
+        if (wIndex >= this.wMaxSegments) {
+            return NULL;  // The cap is reached and every segment is in use
+        }
+    } while (!__atomic_compare_exchange_n(&this.wAllocated, &wIndex, wIndex + 1,
+                                          false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    size_t tAlign = _Alignof(chunk_segment_t);
+    size_t tSize = (sizeof(chunk_segment_t) + this.hwSegmentSize + tAlign - 1) & ~(tAlign - 1);
+    ptSegment = QUEUE_CFG_CHUNK_ALLOC(tAlign, tSize);
+    if (NULL == ptSegment) {
+        return NULL;  // The slot stays empty, chunk_pool_deinit() skips it
+    }
+    ptSegment->wIndex = wIndex;
+    this.pptSegment[wIndex] = ptSegment;  // Published by the first __chunk_pool_put()
+    return ptSegment;
+}
+
+/****************************************************************************
+* Function: __chunk_pool_put                                              *
+* Description: Pushes a segment back onto the free list.                  *
+****************************************************************************/
+static void __chunk_pool_put(chunk_pool_t *ptThis, chunk_segment_t *ptSegment)
+{
+    chunk_pool_word_t tHead = __atomic_load_n(&this.tFreeHead, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&ptSegment->wFreeNext, __chunk_word_index(tHead), __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&this.tFreeHead, &tHead, __chunk_word_next(tHead, ptSegment->wIndex + 1),
+                                          false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/****************************************************************************
+* Function: __chunk_segment_new                                           *
+* Description: Takes a segment from the pool and sets up its ring.        *
+****************************************************************************/
+static chunk_segment_t *__chunk_segment_new(chunk_pool_t *ptPool)
+{
+    chunk_segment_t *ptSegment = __chunk_pool_get(ptPool);
+    if (NULL != ptSegment) {
+        ptSegment->ptNext = NULL;
+        queue_init_spsc(&ptSegment->tQueue, ptSegment->chData, ptPool->hwSegmentSize);
+    }
+    return ptSegment;
+}
+
+/****************************************************************************
+* Function: chunk_queue_init                                              *
+* Description: Initializes a chunk queue with one segment of the pool.    *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_queue_t object to be initialized.      *
+*   - ptPool: Pool the segments are taken from.                           *
+* Returns: Pointer to the initialized chunk_queue_t object or NULL.      *
+****************************************************************************/
+chunk_queue_t *chunk_queue_init(chunk_queue_t *ptObj, chunk_pool_t *ptPool)
+{
+    assert(NULL != ptObj);
+    assert(NULL != ptPool);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_queue_t *ptThis = (chunk_queue_t *)ptObj;
+
+    chunk_segment_t *ptSegment = __chunk_segment_new(ptPool);
+    if (NULL == ptSegment) {
+        return NULL;
+    }
+    this.ptPool = ptPool;
+    this.ptTail = ptSegment;
+    this.ptHead = ptSegment;
+    this.wEnqueued = 0;
+    this.wDequeued = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: chunk_queue_deinit                                            *
+* Description: Returns every segment of the queue to the pool.            *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_queue_t object.                        *
+* Returns: True if successful, false otherwise.                          *
+****************************************************************************/
+bool chunk_queue_deinit(chunk_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_queue_t *ptThis = (chunk_queue_t *)ptObj;
+
+    if (NULL == this.ptHead) {
+        return false;
+    }
+    chunk_segment_t *ptSegment = this.ptHead;
+    while (NULL != ptSegment) {
+        chunk_segment_t *ptNext = ptSegment->ptNext;
+        __chunk_pool_put(this.ptPool, ptSegment);
+        ptSegment = ptNext;
+    }
+    this.ptHead = NULL;
+    this.ptTail = NULL;
+    return true;
+}
+
+/****************************************************************************
+* Function: chunk_enqueue_bytes                                           *
+* Description: Enqueues bytes, producer side. The tail segment is filled  *
+*              as a ring; only when it is full is a new segment linked    *
+*              behind it, and the old one is never written again.         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_queue_t object.                        *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - wDataLength: Number of bytes to enqueue.                            *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+uint32_t chunk_enqueue_bytes(chunk_queue_t *ptObj, const void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_queue_t *ptThis = (chunk_queue_t *)ptObj;
+    const uint8_t *pchByte = pDate;
+    queue_size_t hwSegmentSize = this.ptPool->hwSegmentSize;
+    uint32_t wDone = 0;
+    while (wDone < wDataLength) {
+        uint32_t wLeft = wDataLength - wDone;
+        queue_size_t hwChunk = (wLeft > hwSegmentSize) ? hwSegmentSize : (queue_size_t)wLeft;
+        queue_size_t hwStored = enqueue_bytes(&this.ptTail->tQueue, (void *)&pchByte[wDone], hwChunk);
+        wDone += hwStored;
+        if (hwStored == hwChunk) {
+            continue;
+        }
+        chunk_segment_t *ptSegment = __chunk_segment_new(this.ptPool);
+        if (NULL == ptSegment) {
+            break;  // The pool is exhausted
+        }
+        __atomic_store_n(&this.ptTail->ptNext, ptSegment, __ATOMIC_RELEASE);  // Publish the segment
+        this.ptTail = ptSegment;
+    }
+    __atomic_store_n(&this.wEnqueued, this.wEnqueued + wDone, __ATOMIC_RELEASE);
+    return wDone;
+}
+
+/****************************************************************************
+* Function: chunk_dequeue_bytes                                           *
+* Description: Dequeues bytes, consumer side. A drained segment goes back *
+*              to the pool as soon as the producer has moved past it.     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_queue_t object.                        *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - wDataLength: Number of bytes to dequeue.                            *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+uint32_t chunk_dequeue_bytes(chunk_queue_t *ptObj, void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_queue_t *ptThis = (chunk_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;
+    queue_size_t hwSegmentSize = this.ptPool->hwSegmentSize;
+    uint32_t wDone = 0;
+    while (wDone < wDataLength) {
+        uint32_t wLeft = wDataLength - wDone;
+        queue_size_t hwChunk = (wLeft > hwSegmentSize) ? hwSegmentSize : (queue_size_t)wLeft;
+        queue_size_t hwTaken = dequeue_bytes(&this.ptHead->tQueue, &pchByte[wDone], hwChunk);
+        wDone += hwTaken;
+        if (hwTaken == hwChunk) {
+            continue;
+        }
+        chunk_segment_t *ptNext = __atomic_load_n(&this.ptHead->ptNext, __ATOMIC_ACQUIRE);
+        if (NULL == ptNext) {
+            break;  // The queue is empty
+        }
+        if (!is_queue_empty(&this.ptHead->tQueue)) {
+            continue;  // Written just before the producer moved on
+        }
+        chunk_segment_t *ptSegment = this.ptHead;
+        this.ptHead = ptNext;
+        __chunk_pool_put(this.ptPool, ptSegment);
+    }
+    __atomic_store_n(&this.wDequeued, this.wDequeued + wDone, __ATOMIC_RELEASE);
+    return wDone;
+}
+
+/****************************************************************************
+* Function: is_chunk_queue_empty                                          *
+* Description: Checks if the chunk queue is empty.                        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_queue_t object.                        *
+* Returns: True if the queue is empty, false otherwise.                  *
+****************************************************************************/
+bool is_chunk_queue_empty(chunk_queue_t *ptObj)
+{
+    return 0 == get_chunk_queue_count(ptObj);
+}
+
+/****************************************************************************
+* Function: get_chunk_queue_count                                         *
+* Description: Gets the number of queued bytes.                           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the chunk_queue_t object.                        *
+* Returns: Number of bytes in the queue.                                  *
+****************************************************************************/
+uint32_t get_chunk_queue_count(chunk_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    chunk_queue_t *ptThis = (chunk_queue_t *)ptObj;
+    uint32_t wDequeued = __atomic_load_n(&this.wDequeued, __ATOMIC_ACQUIRE);
+    uint32_t wCount = __atomic_load_n(&this.wEnqueued, __ATOMIC_ACQUIRE) - wDequeued;
+    if ((int32_t)wCount < 0) {  // The consumer took bytes the producer has not counted yet
+        return 0;
+    }
+    return wCount;
+}
@@ -0,0 +1,168 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_CHUNK_QUEUE_H_
+#define QUEUE_CHUNK_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Allocator of the segment pool, called with the alignment and the
+ *        size of one segment. Point them at the RTOS heap if there is no
+ *        C11 aligned_alloc(). Segments are only freed by chunk_pool_deinit().
+ */
+#ifndef QUEUE_CFG_CHUNK_ALLOC
+#   include <stdlib.h>
+#   define QUEUE_CFG_CHUNK_ALLOC(__ALIGN, __SIZE)   aligned_alloc((__ALIGN), (__SIZE))
+#   define QUEUE_CFG_CHUNK_FREE(__PTR)              free(__PTR)
+#endif
+
+/*!
+ * \brief Head of the free list: the index of the top segment plus one in the
+ *        low half, a version tag in the high half against ABA.
+ */
+#if UINTPTR_MAX > 0xFFFFFFFFu
+typedef uint64_t chunk_pool_word_t;
+#else
+typedef uint32_t chunk_pool_word_t;     /* at most 65535 segments */
+#endif
+
+typedef struct chunk_segment_t chunk_segment_t;
+
+/*!
+ * \brief One fixed-size segment: an SPSC byte_queue_t over chData, linked to
+ *        the next segment of the same chunk queue.
+ */
+struct chunk_segment_t {
+    byte_queue_t tQueue;
+    chunk_segment_t *ptNext;            /* published by the producer */
+    uint32_t wFreeNext;                 /* free list link, index + 1 */
+    uint32_t wIndex;                    /* slot in the pool table */
+    uint8_t chData[];
+};
+
+/*!
+ * \brief Lock-free pool of segments, shared by any number of chunk queues.
+ *
+ * \details Segments are allocated on first use, up to wMaxSegments, and go
+ *          back to the pool when a queue is done with them, so the memory in
+ *          use follows the backlog of all queues together.
+ */
+typedef struct chunk_pool_t {
+    chunk_segment_t **pptSegment;       /* wMaxSegments entries */
+    uint32_t wMaxSegments;
+    queue_size_t hwSegmentSize;
+    __QUEUE_CACHE_ALIGNED
+    uint32_t wAllocated;                /* segments created so far */
+    chunk_pool_word_t tFreeHead;
+} chunk_pool_t;
+
+/*!
+ * \brief Unbounded single-producer/single-consumer byte queue built from pool
+ *        segments.
+ *
+ * \details The producer fills its segment as a ring and links a fresh one
+ *          only when that ring is full; the consumer hands a segment back to
+ *          the pool once it is drained and a successor exists. Growing never
+ *          copies or reallocates queued data.
+ */
+typedef struct chunk_queue_t {
+    chunk_pool_t *ptPool;
+    __QUEUE_CACHE_ALIGNED
+    chunk_segment_t *ptTail;            /* producer side */
+    uint32_t wEnqueued;
+    __QUEUE_CACHE_ALIGNED
+    chunk_segment_t *ptHead;            /* consumer side */
+    uint32_t wDequeued;
+} chunk_queue_t;
+
+/*!
+ * \brief Initialize a segment pool.
+ *
+ * \param[in] ptObj pointer to the pool object.
+ * \param[in] hwSegmentSize payload bytes per segment, a power of two keeps
+ *            each segment on the fast counter path.
+ * \param[in] wMaxSegments cap on the segments the pool ever allocates.
+ *
+ * \return the address of the pool, or NULL on failure.
+    E.g.
+    \code
+        static chunk_pool_t s_tPool;
+        static chunk_queue_t s_tRxQueue, s_tTxQueue;
+        chunk_pool_init(&s_tPool, 4096, 256);           // up to 1 MiB in total
+        chunk_queue_init(&s_tRxQueue, &s_tPool);
+        chunk_queue_init(&s_tTxQueue, &s_tPool);
+        chunk_enqueue_bytes(&s_tRxQueue, chBurst, wBurstSize);
+    \endcode
+ */
+extern
+chunk_pool_t *chunk_pool_init(chunk_pool_t *ptObj, queue_size_t hwSegmentSize, uint32_t wMaxSegments);
+
+/*!
+ * \brief Free every segment of the pool. No queue may use it any more.
+ */
+extern
+bool chunk_pool_deinit(chunk_pool_t *ptObj);
+
+/*!
+ * \brief Get the number of segments the pool has allocated so far.
+ */
+extern
+uint32_t get_chunk_pool_allocated(chunk_pool_t *ptObj);
+
+/*!
+ * \brief Initialize a chunk queue on a pool.
+ *
+ * \return the address of the queue, or NULL if the pool has no segment left.
+ */
+extern
+chunk_queue_t *chunk_queue_init(chunk_queue_t *ptObj, chunk_pool_t *ptPool);
+
+/*!
+ * \brief Return all segments of the queue to its pool, dropping queued data.
+ */
+extern
+bool chunk_queue_deinit(chunk_queue_t *ptObj);
+
+/*!
+ * \brief Put data into the queue, producer side.
+ *
+ * \return the number of bytes stored, less than wDataLength only if the pool
+ *         ran out of segments.
+ */
+extern
+uint32_t chunk_enqueue_bytes(chunk_queue_t *ptObj, const void *pDate, uint32_t wDataLength);
+
+/*!
+ * \brief Get data from the queue, consumer side.
+ */
+extern
+uint32_t chunk_dequeue_bytes(chunk_queue_t *ptObj, void *pDate, uint32_t wDataLength);
+
+extern
+bool is_chunk_queue_empty(chunk_queue_t *ptObj);
+
+extern
+uint32_t get_chunk_queue_count(chunk_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_CHUNK_QUEUE_H_ */
@@ -0,0 +1,95 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "fd_queue.h"
+#include <errno.h>
+#include <sys/uio.h>
+
+/****************************************************************************
+* Function: __queue_fd_iovec                                              *
+* Description: Turns the spans handed out by the queue into an I/O vector *
+*              for readv()/writev().                                      *
+* Returns: Number of vector entries in use.                               *
+****************************************************************************/
+static int __queue_fd_iovec(const queue_span_t tSpan[2], struct iovec tVector[2])
+{
+    tVector[0].iov_base = tSpan[0].pchBuffer;
+    tVector[0].iov_len = tSpan[0].hwLength;
+    tVector[1].iov_base = tSpan[1].pchBuffer;
+    tVector[1].iov_len = tSpan[1].hwLength;
+    return (0 == tSpan[1].hwLength) ? 1 : 2;
+}
+
+/****************************************************************************
+* Function: queue_read_fd                                                 *
+* Description: Reads from a file descriptor into the free space of the    *
+*              byte queue and commits whatever arrived.                   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - nFd: File descriptor to read from.                                  *
+* Returns: Bytes enqueued, 0 on end of file, -1 on error (errno set).    *
+****************************************************************************/
+ssize_t queue_read_fd(byte_queue_t *ptObj, int nFd)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    queue_span_t tSpan[2];
+    struct iovec tVector[2];
+    if (0 == enqueue_reserve(ptObj, tSpan)) {
+        errno = (0 == get_queue_available_count(ptObj)) ? ENOBUFS : EBUSY;
+        return -1;
+    }
+    ssize_t nResult;
+    int nCount = __queue_fd_iovec(tSpan, tVector);
+    do {
+        nResult = readv(nFd, tVector, nCount);
+    } while (nResult < 0 && EINTR == errno);
+    int nError = errno;
+    enqueue_commit(ptObj, (nResult > 0) ? (queue_size_t)nResult : 0);  // Also unlocks the queue
+    errno = nError;
+    return nResult;
+}
+
+/****************************************************************************
+* Function: queue_write_fd                                                *
+* Description: Writes the queued data to a file descriptor and removes    *
+*              what the kernel accepted.                                  *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the byte_queue_t object.                         *
+*   - nFd: File descriptor to write to.                                   *
+* Returns: Bytes dequeued, 0 if the queue is empty, -1 on error.         *
+****************************************************************************/
+ssize_t queue_write_fd(byte_queue_t *ptObj, int nFd)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    queue_span_t tSpan[2];
+    struct iovec tVector[2];
+    if (0 == dequeue_acquire(ptObj, tSpan)) {
+        if (is_queue_empty(ptObj)) {
+            return 0;
+        }
+        errno = EBUSY;
+        return -1;
+    }
+    ssize_t nResult;
+    int nCount = __queue_fd_iovec(tSpan, tVector);
+    do {
+        nResult = writev(nFd, tVector, nCount);
+    } while (nResult < 0 && EINTR == errno);
+    int nError = errno;
+    dequeue_release(ptObj, (nResult > 0) ? (queue_size_t)nResult : 0);  // Also unlocks the queue
+    errno = nError;
+    return nResult;
+}
@@ -0,0 +1,84 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_FD_QUEUE_H_
+#define QUEUE_FD_QUEUE_H_
+#include "byte_queue.h"
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Fill the ring buffer straight from a file descriptor.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] nFd file descriptor to read from, e.g. a socket or a tty.
+ *
+ * \return Return the number of bytes read into the queue, 0 on end of file,
+ *         or -1 with errno set: EAGAIN if the descriptor has no data,
+ *         ENOBUFS if the queue is full, EBUSY if another thread is using it,
+ *         or whatever readv() failed with.
+ *
+ * \details One readv() covers the whole free space, its one or two regions
+ *          are passed to the kernel as they are, so the bytes are copied once
+ *          instead of through a stack buffer and enqueue_bytes(). A short
+ *          read commits what arrived. The queue stays reserved during the
+ *          call, so use a non-blocking descriptor unless only this thread
+ *          ever writes to the queue.
+    E.g.
+    \code
+        // EPOLLIN on a non-blocking socket
+        for (;;) {
+            ssize_t nResult = queue_read_fd(&s_tRxQueue, nSocket);
+            if (nResult > 0) {
+                continue;
+            }
+            if (0 == nResult) {
+                close_connection();
+            } else if (ENOBUFS == errno) {
+                stop_polling_input();       // resume once the parser drained the queue
+            }
+            break;                          // EAGAIN: wait for the next event
+        }
+    \endcode
+ */
+extern
+ssize_t queue_read_fd(byte_queue_t *ptObj, int nFd);
+
+/*!
+ * \brief Drain the ring buffer straight into a file descriptor.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] nFd file descriptor to write to.
+ *
+ * \return Return the number of bytes written and removed from the queue, 0 if
+ *         the queue is empty, or -1 with errno set: EAGAIN if the descriptor
+ *         cannot take more data, EBUSY if another thread is using the queue,
+ *         or whatever writev() failed with.
+ *
+ * \details Bytes the kernel did not take stay queued for the next call, so a
+ *          partial write needs no bookkeeping by the caller.
+ */
+extern
+ssize_t queue_write_fd(byte_queue_t *ptObj, int nFd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_FD_QUEUE_H_ */
@@ -0,0 +1,270 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "file_queue.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#undef this
+#define this        (*ptThis)
+
+#define FILE_QUEUE_MAGIC        0x51464C50u     /* "PLFQ" */
+
+/****************************************************************************
+* Function: __file_queue_boot_id                                          *
+* Description: Reads the id of the running boot, which changes whenever   *
+*              the page cache may have been lost.                          *
+****************************************************************************/
+static void __file_queue_boot_id(char chBootId[40])
+{
+    memset(chBootId, 0, 40);
+    int nFd = open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+    if (nFd >= 0) {
+        if (read(nFd, chBootId, 39) < 0) {
+            chBootId[0] = '\0';  // Unknown boot, always recover from the synced counters
+        }
+        close(nFd);
+    }
+}
+
+/****************************************************************************
+* Function: file_queue_open                                               *
+* Description: Opens or creates a persistent file-backed byte queue.      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle to be initialized.       *
+*   - pchPath: Path of the queue file.                                    *
+*   - wSize: Size of the data area, must be a power of two.               *
+* Returns: Pointer to the initialized file_queue_t handle or NULL.       *
+****************************************************************************/
+file_queue_t *file_queue_open(file_queue_t *ptObj, const char *pchPath, uint32_t wSize)
+{
+    assert(NULL != ptObj);
+    assert(NULL != pchPath);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    file_queue_t *ptThis = (file_queue_t *)ptObj;
+
+    long lPageSize = sysconf(_SC_PAGESIZE);
+    if (wSize == 0 || 0 != (wSize & (wSize - 1)) || lPageSize <= 0
+    ||  sizeof(file_queue_hdr_t) > (size_t)lPageSize) {
+        return NULL;
+    }
+    int nFd = open(pchPath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (nFd < 0) {
+        return NULL;
+    }
+    struct stat tStat;
+    size_t tMapSize = (size_t)lPageSize + wSize;  // Header page, then the data area
+    bool bIsNew = (0 == fstat(nFd, &tStat) && 0 == tStat.st_size);
+    if ((bIsNew && 0 != ftruncate(nFd, (off_t)tMapSize))
+    ||  (!bIsNew && (size_t)tStat.st_size != tMapSize)) {
+        close(nFd);
+        return NULL;
+    }
+    void *pBase = mmap(NULL, tMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+    close(nFd);  // The mapping keeps the file open
+    if (MAP_FAILED == pBase) {
+        return NULL;
+    }
+    this.ptHdr = pBase;
+    this.pchBuffer = (uint8_t *)pBase + lPageSize;
+    this.wMask = wSize - 1;
+    this.tMapSize = tMapSize;
+
+    file_queue_hdr_t *ptHdr = this.ptHdr;
+    char chBootId[40];
+    __file_queue_boot_id(chBootId);
+    if (FILE_QUEUE_MAGIC != ptHdr->wMagic) {  // New file, or it died before being set up
+        ptHdr->wSize = wSize;
+        ptHdr->wDataOffset = (uint32_t)lPageSize;
+        ptHdr->wSyncedHead = 0;
+        ptHdr->wSyncedTail = 0;
+        ptHdr->wHead = 0;
+        ptHdr->wTail = 0;
+        memcpy(ptHdr->chBootId, chBootId, sizeof(chBootId));
+        ptHdr->wMagic = FILE_QUEUE_MAGIC;
+    } else if (ptHdr->wSize != wSize || ptHdr->wDataOffset != (uint32_t)lPageSize) {
+        munmap(pBase, tMapSize);
+        this.ptHdr = NULL;
+        return NULL;
+    } else if (0 == chBootId[0] || 0 != memcmp(ptHdr->chBootId, chBootId, sizeof(chBootId))) {
+        /* the page cache did not survive, only the synced state is trustworthy */
+        ptHdr->wHead = ptHdr->wSyncedHead;
+        ptHdr->wTail = ptHdr->wSyncedTail;
+        memcpy(ptHdr->chBootId, chBootId, sizeof(chBootId));
+    }
+    if (0 != msync(ptHdr, (size_t)lPageSize, MS_SYNC)) {
+        munmap(pBase, tMapSize);
+        this.ptHdr = NULL;
+        return NULL;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: file_queue_flush                                              *
+* Description: Syncs the data area, then records the counters covering it *
+*              as the durable state and syncs the header page.            *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle.                         *
+* Returns: True on success, false otherwise.                             *
+****************************************************************************/
+bool file_queue_flush(file_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    file_queue_t *ptThis = (file_queue_t *)ptObj;
+    file_queue_hdr_t *ptHdr = this.ptHdr;
+    /* only data that is already published may be declared durable */
+    uint32_t wTail = __atomic_load_n(&ptHdr->wTail, __ATOMIC_ACQUIRE);
+    uint32_t wHead = __atomic_load_n(&ptHdr->wHead, __ATOMIC_ACQUIRE);
+    if (0 != msync(this.pchBuffer, this.wMask + 1, MS_SYNC)) {  // Only dirty pages are written
+        return false;
+    }
+    ptHdr->wSyncedTail = wTail;
+    __atomic_store_n(&ptHdr->wSyncedHead, wHead, __ATOMIC_RELEASE);  // Frees space for the producer
+    return 0 == msync(ptHdr, (size_t)(this.pchBuffer - (uint8_t *)ptHdr), MS_SYNC);
+}
+
+/****************************************************************************
+* Function: file_queue_close                                              *
+* Description: Flushes a persistent byte queue and unmaps its file.       *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle.                         *
+* Returns: True on success, false otherwise.                             *
+****************************************************************************/
+bool file_queue_close(file_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    file_queue_t *ptThis = (file_queue_t *)ptObj;
+    if (NULL == this.ptHdr) {
+        return false;
+    }
+    bool bSynced = file_queue_flush(ptObj);
+    munmap(this.ptHdr, this.tMapSize);
+    this.ptHdr = NULL;
+    this.pchBuffer = NULL;
+    return bSynced;
+}
+
+/****************************************************************************
+* Function: file_enqueue_bytes                                            *
+* Description: Enqueues bytes, producer side. The data is written before  *
+*              wTail is published, and never over bytes that the synced  *
+*              state still covers.                                        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle.                         *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - wDataLength: Number of bytes to enqueue.                            *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+uint32_t file_enqueue_bytes(file_queue_t *ptObj, const void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    file_queue_t *ptThis = (file_queue_t *)ptObj;
+    const uint8_t *pchByte = pDate;
+    uint32_t wTail = __atomic_load_n(&this.ptHdr->wTail, __ATOMIC_RELAXED);  // Owned by the producer
+    uint32_t wHead = __atomic_load_n(&this.ptHdr->wSyncedHead, __ATOMIC_ACQUIRE);
+    uint32_t wFree = this.wMask + 1 - (wTail - wHead);
+    if (wDataLength > wFree) {  // If not enough space
+        wDataLength = wFree;  // Adjust data length
+    }
+    if (0 == wDataLength) {
+        return 0;
+    }
+    uint32_t wIndex = wTail & this.wMask;
+    uint32_t wFirst = this.wMask + 1 - wIndex;
+    if (wDataLength <= wFirst) {
+        memcpy(&this.pchBuffer[wIndex], pchByte, wDataLength);  // Copy data to buffer
+    } else {
+        memcpy(&this.pchBuffer[wIndex], &pchByte[0], wFirst);  // Copy first part
+        memcpy(&this.pchBuffer[0], &pchByte[wFirst], wDataLength - wFirst);  // Copy second part
+    }
+    __atomic_store_n(&this.ptHdr->wTail, wTail + wDataLength, __ATOMIC_RELEASE);  // Commit the data
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: file_dequeue_bytes                                            *
+* Description: Dequeues bytes, consumer side.                             *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle.                         *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - wDataLength: Number of bytes to dequeue.                            *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+uint32_t file_dequeue_bytes(file_queue_t *ptObj, void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    file_queue_t *ptThis = (file_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;
+    uint32_t wHead = __atomic_load_n(&this.ptHdr->wHead, __ATOMIC_RELAXED);  // Owned by the consumer
+    uint32_t wTail = __atomic_load_n(&this.ptHdr->wTail, __ATOMIC_ACQUIRE);
+    if (wDataLength > wTail - wHead) {  // If requested length exceeds available data
+        wDataLength = wTail - wHead;  // Adjust data length
+    }
+    if (0 == wDataLength) {
+        return 0;
+    }
+    uint32_t wIndex = wHead & this.wMask;
+    uint32_t wFirst = this.wMask + 1 - wIndex;
+    if (wDataLength <= wFirst) {
+        memcpy(pchByte, &this.pchBuffer[wIndex], wDataLength);  // Copy data from buffer
+    } else {
+        memcpy(&pchByte[0], &this.pchBuffer[wIndex], wFirst);  // Copy first part
+        memcpy(&pchByte[wFirst], &this.pchBuffer[0], wDataLength - wFirst);  // Copy second part
+    }
+    __atomic_store_n(&this.ptHdr->wHead, wHead + wDataLength, __ATOMIC_RELEASE);
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: is_file_queue_empty                                           *
+* Description: Checks if the persistent byte queue is empty.              *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle.                         *
+* Returns: True if the queue is empty, false otherwise.                  *
+****************************************************************************/
+bool is_file_queue_empty(file_queue_t *ptObj)
+{
+    return 0 == get_file_queue_count(ptObj);
+}
+
+/****************************************************************************
+* Function: get_file_queue_count                                          *
+* Description: Gets the number of bytes waiting in the persistent queue.  *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the file_queue_t handle.                         *
+* Returns: Number of bytes in the queue.                                  *
+****************************************************************************/
+uint32_t get_file_queue_count(file_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    file_queue_t *ptThis = (file_queue_t *)ptObj;
+    uint32_t wHead = __atomic_load_n(&this.ptHdr->wHead, __ATOMIC_ACQUIRE);
+    uint32_t wTail = __atomic_load_n(&this.ptHdr->wTail, __ATOMIC_ACQUIRE);
+    if (wTail - wHead > this.wMask + 1) {  // wHead was read before both sides moved on
+        return this.wMask + 1;
+    }
+    return wTail - wHead;
+}
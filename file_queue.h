@@ -0,0 +1,127 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+
+#ifndef QUEUE_FILE_QUEUE_H_
+#define QUEUE_FILE_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Header page of a queue file, followed by the data area at
+ *        wDataOffset.
+ *
+ * \details The live counters wHead/wTail are stored with release semantics
+ *          after the data they cover, so after a process crash the page cache
+ *          holds a consistent queue. wSyncedHead/wSyncedTail are only written
+ *          by file_queue_flush() after the data area has reached the disk;
+ *          they are what a queue reopens with after the whole system went
+ *          down, which chBootId tells apart.
+ */
+typedef struct file_queue_hdr_t {
+    uint32_t wMagic;                            /* set last by the creator */
+    uint32_t wSize;                             /* data area size, a power of two */
+    uint32_t wDataOffset;                       /* data area, from the file start */
+    uint32_t wSyncedHead;                       /* durable copy of wHead */
+    uint32_t wSyncedTail;                       /* durable copy of wTail */
+    char chBootId[40];                          /* boot the live counters belong to */
+    __QUEUE_CACHE_ALIGNED uint32_t wTail;      /* written by the producer */
+    __QUEUE_CACHE_ALIGNED uint32_t wHead;      /* written by the consumer */
+} file_queue_hdr_t;
+
+/*!
+ * \brief Process-local handle of a persistent file-backed byte queue.
+ *
+ * \details One thread enqueues and one thread dequeues (SPSC). Space given
+ *          back by dequeue is only reused after the next file_queue_flush(),
+ *          so bytes that a recovery may still replay are never overwritten.
+ */
+typedef struct file_queue_t {
+    file_queue_hdr_t *ptHdr;
+    uint8_t *pchBuffer;
+    uint32_t wMask;
+    size_t tMapSize;
+} file_queue_t;
+
+/*!
+ * \brief Open a queue file, creating it if it does not exist.
+ *
+ * \param[in] ptObj pointer to the queue handle.
+ * \param[in] pchPath path of the queue file.
+ * \param[in] wSize size of the data area in bytes, must be a power of two and
+ *            match the size of an existing file.
+ *
+ * \return the address of the handle, or NULL on failure.
+ *
+ * \details An existing file reopens with every enqueue that completed before
+ *          the process died. After a system crash or power loss it reopens
+ *          with the state of the last file_queue_flush(): no torn data, but
+ *          bytes dequeued after that flush are delivered again.
+    E.g.
+    \code
+        static file_queue_t s_tLog;
+        file_queue_open(&s_tLog, "/var/lib/app/telemetry.q", 1 << 20);
+        for (;;) {
+            while (get_sample(&tSample)) {
+                file_enqueue_bytes(&s_tLog, &tSample, sizeof(tSample));
+            }
+            file_queue_flush(&s_tLog);      // one msync per batch
+        }
+    \endcode
+ */
+extern
+file_queue_t *file_queue_open(file_queue_t *ptObj, const char *pchPath, uint32_t wSize);
+
+/*!
+ * \brief Flush the queue and unmap the file.
+ */
+extern
+bool file_queue_close(file_queue_t *ptObj);
+
+/*!
+ * \brief Make everything enqueued and dequeued so far durable.
+ *
+ * \param[in] ptObj pointer to the queue handle.
+ *
+ * \return false if the file could not be synced.
+ *
+ * \details Syncs the dirty data pages first and the counters second, so a
+ *          crash never sees counters covering data that is not on the disk.
+ *          Call it from the producer thread, once per batch of enqueues.
+ */
+extern
+bool file_queue_flush(file_queue_t *ptObj);
+
+extern
+uint32_t file_enqueue_bytes(file_queue_t *ptObj, const void *pDate, uint32_t wDataLength);
+
+extern
+uint32_t file_dequeue_bytes(file_queue_t *ptObj, void *pDate, uint32_t wDataLength);
+
+extern
+bool is_file_queue_empty(file_queue_t *ptObj);
+
+extern
+uint32_t get_file_queue_count(file_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_FILE_QUEUE_H_ */
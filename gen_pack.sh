@@ -39,6 +39,22 @@ DEFAULT_ARGS=(-c "v")
    LICENSE
    byte_queue.c
    byte_queue.h
+   byte_queue.hpp
+   mpmc_queue.c
+   mpmc_queue.h
+   broadcast_queue.c
+   broadcast_queue.h
+   chunk_queue.c
+   chunk_queue.h
+   prio_queue.c
+   prio_queue.h
+   shard_queue.c
+   shard_queue.h
+   lz_queue.c
+   lz_queue.h
+   overwrite_queue.c
+   overwrite_queue.h
+   typed_queue.h
    README.md
  "
 
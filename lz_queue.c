@@ -0,0 +1,488 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "lz_queue.h"
+#include <string.h>
+#undef this
+#define this        (*ptThis)
+
+#define __LZ_STORED         0                   /* block kept as is */
+#define __LZ_BLOCK          1                   /* LZ4 block format */
+
+#define __LZ_MIN_MATCH      4
+#define __LZ_MF_LIMIT       12                  /* no match starts in the last 12 bytes */
+#define __LZ_LAST_LITERALS  5                   /* and none reaches the last 5 */
+
+#define __LZ_PACKED_SIZE(__BLOCK)   (LZ_QUEUE_HEADER_SIZE + LZ_QUEUE_BOUND((size_t)(__BLOCK)))
+
+static inline uint32_t __lz_read32(const uint8_t *pchByte)
+{
+    uint32_t wValue;
+    memcpy(&wValue, pchByte, sizeof(wValue));
+    return wValue;
+}
+
+static inline uint32_t __lz_hash(uint32_t wSequence)
+{
+    return (wSequence * 2654435761u) >> (32 - LZ_QUEUE_HASH_BITS);
+}
+
+/****************************************************************************
+* Function: __lz_put_length                                               *
+* Description: Writes the part of a length past 15 as a run of 255s and a *
+*              final byte below 255.                                      *
+****************************************************************************/
+static uint8_t *__lz_put_length(uint8_t *pchOut, size_t tLength)
+{
+    while (tLength >= 255) {
+        *pchOut++ = 255;
+        tLength -= 255;
+    }
+    *pchOut++ = (uint8_t)tLength;
+    return pchOut;
+}
+
+/****************************************************************************
+* Function: __lz_put_sequence                                             *
+* Description: Writes one sequence: token, literals and, unless hwMatch   *
+*              is 0 (the last sequence), offset and match length.         *
+****************************************************************************/
+static uint8_t *__lz_put_sequence(uint8_t *pchOut, const uint8_t *pchLiteral, size_t tLiteral,
+                                  size_t tOffset, size_t tMatch)
+{
+    uint8_t *pchToken = pchOut++;
+    uint8_t chToken;
+    if (tLiteral >= 15) {
+        chToken = 0xF0;
+        pchOut = __lz_put_length(pchOut, tLiteral - 15);
+    } else {
+        chToken = (uint8_t)(tLiteral << 4);
+    }
+    memcpy(pchOut, pchLiteral, tLiteral);
+    pchOut += tLiteral;
+    if (0 != tMatch) {
+        *pchOut++ = (uint8_t)tOffset;
+        *pchOut++ = (uint8_t)(tOffset >> 8);
+        tMatch -= __LZ_MIN_MATCH;
+        if (tMatch >= 15) {
+            chToken |= 0x0F;
+            pchOut = __lz_put_length(pchOut, tMatch - 15);
+        } else {
+            chToken |= (uint8_t)tMatch;
+        }
+    }
+    *pchToken = chToken;
+    return pchOut;
+}
+
+/****************************************************************************
+* Function: __lz_compress                                                 *
+* Description: Greedy single-probe LZ4 block compressor. Positions that   *
+*              keep missing are skipped at a growing stride, so data that *
+*              does not compress costs little more than a copy.           *
+* Returns: Size of the compressed block, at most LZ_QUEUE_BOUND(hwLength).*
+****************************************************************************/
+static size_t __lz_compress(uint16_t *phwHash, const uint8_t *pchIn, size_t tLength, uint8_t *pchOut)
+{
+    uint8_t *pchStart = pchOut;
+    size_t tAnchor = 0;
+    if (tLength > __LZ_MF_LIMIT) {
+        size_t tLimit = tLength - __LZ_MF_LIMIT;
+        size_t tMatchLimit = tLength - __LZ_LAST_LITERALS;
+        size_t tPos = 1;
+        memset(phwHash, 0, sizeof(uint16_t) << LZ_QUEUE_HASH_BITS);  // Stale entries are caught by the compare
+        while (tPos < tLimit) {
+            uint32_t wSequence = __lz_read32(&pchIn[tPos]);
+            uint32_t wHash = __lz_hash(wSequence);
+            size_t tRef = phwHash[wHash];
+            phwHash[wHash] = (uint16_t)tPos;
+            if (__lz_read32(&pchIn[tRef]) != wSequence) {
+                tPos += 1 + ((tPos - tAnchor) >> 6);
+                continue;
+            }
+            size_t tMatch = __LZ_MIN_MATCH;
+            while (tPos + tMatch + 4 <= tMatchLimit
+                && __lz_read32(&pchIn[tRef + tMatch]) == __lz_read32(&pchIn[tPos + tMatch])) {
+                tMatch += 4;
+            }
+            while (tPos + tMatch < tMatchLimit && pchIn[tRef + tMatch] == pchIn[tPos + tMatch]) {
+                tMatch++;
+            }
+            while (tPos > tAnchor && tRef > 0 && pchIn[tPos - 1] == pchIn[tRef - 1]) {  // Extend backwards
+                tPos--;
+                tRef--;
+                tMatch++;
+            }
+            pchOut = __lz_put_sequence(pchOut, &pchIn[tAnchor], tPos - tAnchor, tPos - tRef, tMatch);
+            tPos += tMatch;
+            tAnchor = tPos;
+            if (tPos < tLimit) {
+                phwHash[__lz_hash(__lz_read32(&pchIn[tPos - 2]))] = (uint16_t)(tPos - 2);
+            }
+        }
+    }
+    pchOut = __lz_put_sequence(pchOut, &pchIn[tAnchor], tLength - tAnchor, 0, 0);
+    return (size_t)(pchOut - pchStart);
+}
+
+/****************************************************************************
+* Function: __lz_get_length                                               *
+* Description: Adds the 255-run continuation of a length to *ptLength.    *
+* Returns: False if the input ends inside the run.                        *
+****************************************************************************/
+static bool __lz_get_length(const uint8_t **ppchIn, const uint8_t *pchEnd, size_t *ptLength)
+{
+    uint8_t chByte;
+    do {
+        if (*ppchIn >= pchEnd) {
+            return false;
+        }
+        chByte = *(*ppchIn)++;
+        *ptLength += chByte;
+    } while (255 == chByte);
+    return true;
+}
+
+/****************************************************************************
+* Function: __lz_decompress                                               *
+* Description: Decodes an LZ4 block into at most tOutSize bytes. Every    *
+*              length and offset is checked, so a damaged block is        *
+*              reported instead of writing out of bounds.                 *
+* Returns: True and the decoded size in *ptLength, false if damaged.      *
+****************************************************************************/
+static bool __lz_decompress(const uint8_t *pchIn, size_t tInLength, uint8_t *pchOut, size_t tOutSize,
+                            size_t *ptLength)
+{
+    const uint8_t *pchEnd = pchIn + tInLength;
+    uint8_t *pchDst = pchOut;
+    uint8_t *pchDstEnd = pchOut + tOutSize;
+    while (pchIn < pchEnd) {
+        uint8_t chToken = *pchIn++;
+        size_t tLiteral = chToken >> 4;
+        if (15 == tLiteral && !__lz_get_length(&pchIn, pchEnd, &tLiteral)) {
+            return false;
+        }
+        if (tLiteral > (size_t)(pchEnd - pchIn) || tLiteral > (size_t)(pchDstEnd - pchDst)) {
+            return false;
+        }
+        memcpy(pchDst, pchIn, tLiteral);
+        pchDst += tLiteral;
+        pchIn += tLiteral;
+        if (pchIn == pchEnd) {
+            break;  // The last sequence has no match
+        }
+        if (pchEnd - pchIn < 2) {
+            return false;
+        }
+        size_t tOffset = (size_t)pchIn[0] | ((size_t)pchIn[1] << 8);
+        pchIn += 2;
+        size_t tMatch = chToken & 0x0F;
+        if (15 == tMatch && !__lz_get_length(&pchIn, pchEnd, &tMatch)) {
+            return false;
+        }
+        tMatch += __LZ_MIN_MATCH;
+        if (0 == tOffset || tOffset > (size_t)(pchDst - pchOut) || tMatch > (size_t)(pchDstEnd - pchDst)) {
+            return false;
+        }
+        const uint8_t *pchRef = pchDst - tOffset;
+        if (tOffset >= tMatch) {
+            memcpy(pchDst, pchRef, tMatch);
+        } else {
+            for (size_t i = 0; i < tMatch; i++) {  // Overlapping copy repeats the pattern
+                pchDst[i] = pchRef[i];
+            }
+        }
+        pchDst += tMatch;
+    }
+    *ptLength = (size_t)(pchDst - pchOut);
+    return true;
+}
+
+/****************************************************************************
+* Function: lz_queue_init                                                 *
+* Description: Initializes a compressed stream over a byte queue.         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object to be initialized.         *
+*   - ptQueue: Queue receiving the sealed blocks.                         *
+*   - pWork: LZ_QUEUE_WORK_SIZE(hwBlockSize) bytes of work buffer.        *
+*   - hwBlockSize: Bytes per block.                                       *
+* Returns: Pointer to the initialized lz_queue_t object or NULL.          *
+****************************************************************************/
+lz_queue_t *lz_queue_init(lz_queue_t *ptObj, byte_queue_t *ptQueue, void *pWork, queue_size_t hwBlockSize)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    lz_queue_t *ptThis = (lz_queue_t *)ptObj;
+
+    if (NULL == ptQueue || NULL == pWork || 0 != ((uintptr_t)pWork & 1) || ptQueue->bIsCover) {
+        return NULL;
+    }
+    if ((queue_size_t)(hwBlockSize - 1) >= LZ_QUEUE_MAX_BLOCK) {
+        return NULL;  // 0 wraps around as well
+    }
+    if (sizeof(queue_size_t) + __LZ_PACKED_SIZE(hwBlockSize) > ptQueue->hwSize) {
+        return NULL;  // A sealed block must fit as one message
+    }
+    this.ptQueue = ptQueue;
+    this.hwBlockSize = hwBlockSize;
+    this.phwHash = (uint16_t *)pWork;
+    this.pchBlock = (uint8_t *)pWork + (sizeof(uint16_t) << LZ_QUEUE_HASH_BITS);
+    this.pchPacked = this.pchBlock + hwBlockSize;
+    this.pchIn = this.pchPacked + __LZ_PACKED_SIZE(hwBlockSize);
+    this.pchOut = this.pchIn + __LZ_PACKED_SIZE(hwBlockSize);
+    this.hwBlockLength = 0;
+    this.hwPackedLength = 0;
+    this.wEnqueued = 0;
+    this.pchRead = this.pchOut;
+    this.hwReadLength = 0;
+    this.hwReadPos = 0;
+    this.wDequeued = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: __lz_seal                                                     *
+* Description: Compresses the open block into pchPacked behind the block  *
+*              header. A block that does not shrink is stored as is.      *
+****************************************************************************/
+static void __lz_seal(lz_queue_t *ptThis)
+{
+    queue_size_t hwRaw = this.hwBlockLength;
+    uint8_t *pchData = &this.pchPacked[LZ_QUEUE_HEADER_SIZE];
+    size_t tPacked = __lz_compress(this.phwHash, this.pchBlock, hwRaw, pchData);
+    if (tPacked < hwRaw) {
+        this.pchPacked[0] = __LZ_BLOCK;
+    } else {
+        this.pchPacked[0] = __LZ_STORED;
+        memcpy(pchData, this.pchBlock, hwRaw);
+        tPacked = hwRaw;
+    }
+    memcpy(&this.pchPacked[1], &hwRaw, sizeof(hwRaw));
+    this.hwPackedLength = (queue_size_t)(LZ_QUEUE_HEADER_SIZE + tPacked);
+    this.hwBlockLength = 0;
+}
+
+/****************************************************************************
+* Function: __lz_publish                                                  *
+* Description: Puts the sealed block, if any, into the queue.             *
+* Returns: True if no sealed block is left waiting.                       *
+****************************************************************************/
+static bool __lz_publish(lz_queue_t *ptThis)
+{
+    if (0 == this.hwPackedLength) {
+        return true;
+    }
+    if (0 == enqueue_message(this.ptQueue, this.pchPacked, this.hwPackedLength)) {
+        return false;
+    }
+    this.hwPackedLength = 0;
+    return true;
+}
+
+/****************************************************************************
+* Function: __lz_fetch                                                    *
+* Description: Takes the next sealed block out of the queue and decodes   *
+*              it. A damaged block is dropped and its bytes counted as    *
+*              delivered, so the logical count stays right.               *
+* Returns: True if a block is ready to be read.                           *
+****************************************************************************/
+static bool __lz_fetch(lz_queue_t *ptThis)
+{
+    for (;;) {
+        queue_size_t hwLength = dequeue_message(this.ptQueue, this.pchIn, __LZ_PACKED_SIZE(this.hwBlockSize));
+        if (0 == hwLength) {
+            return false;
+        }
+        queue_size_t hwRaw = 0;
+        if (hwLength >= LZ_QUEUE_HEADER_SIZE) {
+            memcpy(&hwRaw, &this.pchIn[1], sizeof(hwRaw));
+            const uint8_t *pchData = &this.pchIn[LZ_QUEUE_HEADER_SIZE];
+            size_t tData = hwLength - LZ_QUEUE_HEADER_SIZE;
+            size_t tDecoded = 0;
+            if (__LZ_STORED == this.pchIn[0] && tData == hwRaw) {
+                this.pchRead = pchData;  // Read it where it is
+            } else if (__LZ_BLOCK == this.pchIn[0]
+                    && __lz_decompress(pchData, tData, this.pchOut, this.hwBlockSize, &tDecoded)
+                    && tDecoded == hwRaw) {
+                this.pchRead = this.pchOut;
+            } else {
+                hwLength = 0;
+            }
+        }
+        if (hwLength >= LZ_QUEUE_HEADER_SIZE) {
+            this.hwReadLength = hwRaw;
+            this.hwReadPos = 0;
+            return true;
+        }
+        __atomic_store_n(&this.wDequeued, this.wDequeued + hwRaw, __ATOMIC_RELEASE);
+    }
+}
+
+/****************************************************************************
+* Function: lz_enqueue_bytes                                              *
+* Description: Copies bytes into the open block and seals every block     *
+*              that fills up.                                             *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - hwDataLength: Number of bytes to enqueue.                           *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+queue_size_t lz_enqueue_bytes(lz_queue_t *ptObj, const void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    lz_queue_t *ptThis = (lz_queue_t *)ptObj;
+
+    if (!__lz_publish(ptThis)) {
+        return 0;  // The last sealed block still waits for room
+    }
+    const uint8_t *pchByte = (const uint8_t *)pDate;
+    queue_size_t hwDone = 0;
+    while (hwDone < hwDataLength) {
+        queue_size_t hwChunk = this.hwBlockSize - this.hwBlockLength;
+        if (hwChunk > hwDataLength - hwDone) {
+            hwChunk = hwDataLength - hwDone;
+        }
+        memcpy(&this.pchBlock[this.hwBlockLength], &pchByte[hwDone], hwChunk);
+        this.hwBlockLength += hwChunk;
+        hwDone += hwChunk;
+        /* counted before the block is visible, so the count never goes negative */
+        __atomic_store_n(&this.wEnqueued, this.wEnqueued + hwChunk, __ATOMIC_RELEASE);
+        if (this.hwBlockLength == this.hwBlockSize) {
+            __lz_seal(ptThis);
+            if (!__lz_publish(ptThis)) {
+                break;
+            }
+        }
+    }
+    return hwDone;
+}
+
+/****************************************************************************
+* Function: lz_queue_flush                                                *
+* Description: Seals the open block and puts it into the queue.           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+* Returns: True if nothing is left waiting for room.                      *
+****************************************************************************/
+bool lz_queue_flush(lz_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    lz_queue_t *ptThis = (lz_queue_t *)ptObj;
+
+    if (!__lz_publish(ptThis)) {
+        return false;
+    }
+    if (0 != this.hwBlockLength) {
+        __lz_seal(ptThis);
+        return __lz_publish(ptThis);
+    }
+    return true;
+}
+
+/****************************************************************************
+* Function: lz_dequeue_bytes                                              *
+* Description: Copies decoded bytes out, decoding blocks as needed.       *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - hwDataLength: Number of bytes to dequeue.                           *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+queue_size_t lz_dequeue_bytes(lz_queue_t *ptObj, void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    lz_queue_t *ptThis = (lz_queue_t *)ptObj;
+
+    uint8_t *pchByte = (uint8_t *)pDate;
+    queue_size_t hwDone = 0;
+    while (hwDone < hwDataLength) {
+        if (this.hwReadPos == this.hwReadLength && !__lz_fetch(ptThis)) {
+            break;
+        }
+        queue_size_t hwChunk = this.hwReadLength - this.hwReadPos;
+        if (hwChunk > hwDataLength - hwDone) {
+            hwChunk = hwDataLength - hwDone;
+        }
+        memcpy(&pchByte[hwDone], &this.pchRead[this.hwReadPos], hwChunk);
+        this.hwReadPos += hwChunk;
+        hwDone += hwChunk;
+    }
+    if (0 != hwDone) {
+        __atomic_store_n(&this.wDequeued, this.wDequeued + hwDone, __ATOMIC_RELEASE);
+    }
+    return hwDone;
+}
+
+/****************************************************************************
+* Function: get_lz_queue_count                                            *
+* Description: Gets the logical number of bytes held.                     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+* Returns: Bytes enqueued and not yet dequeued.                           *
+****************************************************************************/
+uint32_t get_lz_queue_count(lz_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    lz_queue_t *ptThis = (lz_queue_t *)ptObj;
+    uint32_t wDequeued = __atomic_load_n(&this.wDequeued, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&this.wEnqueued, __ATOMIC_ACQUIRE) - wDequeued;
+}
+
+/****************************************************************************
+* Function: get_lz_queue_physical_count                                   *
+* Description: Gets the bytes the sealed blocks take up in the queue.     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+* Returns: Number of bytes used in the queue.                             *
+****************************************************************************/
+queue_size_t get_lz_queue_physical_count(lz_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    return get_queue_count(ptObj->ptQueue);
+}
+
+/****************************************************************************
+* Function: get_lz_queue_available_count                                  *
+* Description: Gets the free space of the queue.                          *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+* Returns: Number of free bytes in the queue.                             *
+****************************************************************************/
+queue_size_t get_lz_queue_available_count(lz_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    return get_queue_available_count(ptObj->ptQueue);
+}
+
+/****************************************************************************
+* Function: is_lz_queue_empty                                             *
+* Description: Checks if no byte is held, open block included.            *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the lz_queue_t object.                           *
+* Returns: True if the stream is empty, false otherwise.                 *
+****************************************************************************/
+bool is_lz_queue_empty(lz_queue_t *ptObj)
+{
+    return 0 == get_lz_queue_count(ptObj);
+}
@@ -0,0 +1,161 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_LZ_QUEUE_H_
+#define QUEUE_LZ_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief log2 of the match finder's hash table entries. Each entry takes two
+ *        bytes of the work buffer; smaller tables trade ratio for RAM.
+ */
+#ifndef LZ_QUEUE_HASH_BITS
+#   define LZ_QUEUE_HASH_BITS          12
+#endif
+
+#define LZ_QUEUE_MAX_BLOCK          0xFFFF      /* match offsets are 16-bit */
+
+/*! \brief method byte and raw length in front of every sealed block */
+#define LZ_QUEUE_HEADER_SIZE        (1 + sizeof(queue_size_t))
+
+/*! \brief worst case size of a compressed block of __SIZE bytes */
+#define LZ_QUEUE_BOUND(__SIZE)      ((__SIZE) + (__SIZE) / 255 + 16)
+
+/*!
+ * \brief Bytes of work buffer lz_queue_init() needs for blocks of __BLOCK
+ *        bytes: the open block, a sealed block on each side, the decoded
+ *        block and the hash table.
+ */
+#define LZ_QUEUE_WORK_SIZE(__BLOCK)                                            \
+            (   (sizeof(uint16_t) << LZ_QUEUE_HASH_BITS)                        \
+            +   2 * (__BLOCK)                                                  \
+            +   2 * (LZ_QUEUE_HEADER_SIZE + LZ_QUEUE_BOUND(__BLOCK)))
+
+/*!
+ * \brief A byte stream kept compressed in a byte queue.
+ *
+ * \details Enqueued bytes collect in an open block. A full (or flushed) block
+ *          is sealed: compressed in the LZ4 block format, or stored as is if
+ *          that does not shrink it, and put into ptQueue as one message. The
+ *          consumer decodes one block at a time. One producer and one
+ *          consumer thread may use it at the same time.
+ */
+typedef struct lz_queue_t {
+    byte_queue_t *ptQueue;
+    queue_size_t hwBlockSize;
+    /* producer side */
+    __QUEUE_CACHE_ALIGNED
+    uint16_t *phwHash;
+    uint8_t *pchBlock;                          /* open block */
+    uint8_t *pchPacked;                         /* sealed block waiting for room */
+    queue_size_t hwBlockLength;
+    queue_size_t hwPackedLength;                /* 0 if nothing is waiting */
+    uint32_t wEnqueued;                         /* logical bytes accepted */
+    /* consumer side */
+    __QUEUE_CACHE_ALIGNED
+    uint8_t *pchIn;                             /* sealed block taken out */
+    uint8_t *pchOut;                            /* and decoded */
+    const uint8_t *pchRead;                     /* where the decoded bytes are */
+    queue_size_t hwReadLength;
+    queue_size_t hwReadPos;
+    uint32_t wDequeued;                         /* logical bytes delivered */
+} lz_queue_t;
+
+/*!
+ * \brief Initialize a compressed stream over a byte queue.
+ *
+ * \param[in] ptObj pointer to the compressed stream object.
+ * \param[in] ptQueue an initialized queue that is not in cover mode. It holds
+ *            the sealed blocks and must fit one worst case block.
+ * \param[in] pWork LZ_QUEUE_WORK_SIZE(hwBlockSize) bytes, 2-byte aligned.
+ * \param[in] hwBlockSize bytes per block, up to LZ_QUEUE_MAX_BLOCK. Larger
+ *            blocks compress better but hold data back longer.
+ *
+ * \return the address of the compressed stream, or NULL on failure.
+    E.g.
+    \code
+        #define LOG_BLOCK   4096
+        static uint8_t s_chLogBuffer[16 * 1024];
+        static uint16_t s_hwLogWork[LZ_QUEUE_WORK_SIZE(LOG_BLOCK) / 2 + 1];
+        static byte_queue_t s_tLogRing;
+        static lz_queue_t s_tLog;
+        queue_init_spsc(&s_tLogRing, s_chLogBuffer, sizeof(s_chLogBuffer));
+        lz_queue_init(&s_tLog, &s_tLogRing, s_hwLogWork, LOG_BLOCK);
+
+        lz_enqueue_bytes(&s_tLog, chLine, hwLength);
+        ...
+        lz_queue_flush(&s_tLog);                    // when the producer goes idle
+    \endcode
+ */
+extern
+lz_queue_t *lz_queue_init(lz_queue_t *ptObj, byte_queue_t *ptQueue, void *pWork, queue_size_t hwBlockSize);
+
+/*!
+ * \brief Put data into the open block, sealing every block that fills up.
+ *
+ * \return Return the number of bytes accepted. It is short when a sealed
+ *         block does not fit into the queue; that block is retried first on
+ *         the next call.
+ */
+extern
+queue_size_t lz_enqueue_bytes(lz_queue_t *ptObj, const void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Seal the open block so the consumer can read it.
+ *
+ * \return true if no sealed block is still waiting for room.
+ */
+extern
+bool lz_queue_flush(lz_queue_t *ptObj);
+
+/*!
+ * \brief Get decoded data. Only sealed blocks are visible.
+ *
+ * \return Return the number of bytes copied into pDate.
+ */
+extern
+queue_size_t lz_dequeue_bytes(lz_queue_t *ptObj, void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Get the logical number of bytes held, open block included.
+ */
+extern
+uint32_t get_lz_queue_count(lz_queue_t *ptObj);
+
+/*!
+ * \brief Get the number of bytes the sealed blocks take up in the queue.
+ */
+extern
+queue_size_t get_lz_queue_physical_count(lz_queue_t *ptObj);
+
+/*!
+ * \brief Get the free space of the queue, in compressed bytes.
+ */
+extern
+queue_size_t get_lz_queue_available_count(lz_queue_t *ptObj);
+
+extern
+bool is_lz_queue_empty(lz_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_LZ_QUEUE_H_ */
@@ -0,0 +1,182 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "mpmc_queue.h"
+#undef this
+#define this        (*ptThis)
+
+#define __mpmc_slot(__POS)                                                     \
+    ((uint32_t *)&this.pchBuffer[((__POS) & this.wMask) * this.hwSlotSize])
+
+/****************************************************************************
+* Function: mpmc_queue_init                                               *
+* Description: Initializes a MPMC queue object.                           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the mpmc_queue_t object to be initialized.       *
+*   - pBuffer: Pointer to the slot storage.                               *
+*   - hwItemSize: Size of each item in bytes.                             *
+*   - wItemCount: Number of slots, must be a power of two.                *
+* Returns: Pointer to the initialized mpmc_queue_t object or NULL.       *
+****************************************************************************/
+mpmc_queue_t *mpmc_queue_init(mpmc_queue_t *ptObj, void *pBuffer, uint16_t hwItemSize, uint32_t wItemCount)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    mpmc_queue_t *ptThis = (mpmc_queue_t *)ptObj;
+
+    if (pBuffer == NULL || hwItemSize == 0 || wItemCount == 0
+    ||  0 != (wItemCount & (wItemCount - 1))) {
+        return NULL;
+    }
+
+    this.pchBuffer = pBuffer;
+    this.wMask = wItemCount - 1;
+    this.hwItemSize = hwItemSize;
+    this.hwSlotSize = MPMC_QUEUE_SLOT_SIZE(hwItemSize);
+    for (uint32_t wPos = 0; wPos < wItemCount; wPos++) {
+        *__mpmc_slot(wPos) = wPos;  // Slot wPos is free for the lap starting at wPos
+    }
+    this.wTail = 0;
+    this.wHead = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: mpmc_enqueue_items                                            *
+* Description: Enqueues items into the MPMC queue, one slot per item.     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the mpmc_queue_t object.                         *
+*   - pItems: Pointer to the items to be enqueued.                        *
+*   - hwItemSize: Size of each item, at most the slot item size.          *
+*   - wCount: Number of items to enqueue.                                 *
+* Returns: Number of items actually enqueued.                             *
+****************************************************************************/
+uint32_t mpmc_enqueue_items(mpmc_queue_t *ptObj, const void *pItems, uint16_t hwItemSize, uint32_t wCount)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pItems);  // Ensure pItems is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    mpmc_queue_t *ptThis = (mpmc_queue_t *)ptObj;
+    assert(hwItemSize <= this.hwItemSize);  // The item must fit into a slot
+    const uint8_t *pchItem = pItems;
+    uint32_t wDone = 0;
+
+    for (; wDone < wCount; wDone++) {
+        uint32_t *pwSequence;
+        uint32_t wPos = __atomic_load_n(&this.wTail, __ATOMIC_RELAXED);
+        for (;;) {
+            pwSequence = __mpmc_slot(wPos);
+            uint32_t wSequence = __atomic_load_n(pwSequence, __ATOMIC_ACQUIRE);
+            int32_t nDiff = (int32_t)(wSequence - wPos);
+            if (0 == nDiff) {  // The slot is free for this lap, try to claim it
+                if (__atomic_compare_exchange_n(&this.wTail, &wPos, wPos + 1, true,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (nDiff < 0) {  // The slot still holds last lap's item
+                return wDone;  // Queue is full
+            } else {  // Another producer claimed the slot
+                wPos = __atomic_load_n(&this.wTail, __ATOMIC_RELAXED);
+            }
+        }
+        memcpy(&pwSequence[1], &pchItem[wDone * hwItemSize], hwItemSize);  // Copy item to slot
+        __atomic_store_n(pwSequence, wPos + 1, __ATOMIC_RELEASE);  // Hand the slot to consumers
+    }
+    return wDone;
+}
+
+/****************************************************************************
+* Function: mpmc_dequeue_items                                            *
+* Description: Dequeues items from the MPMC queue, one slot per item.     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the mpmc_queue_t object.                         *
+*   - pItems: Pointer to store the dequeued items.                        *
+*   - hwItemSize: Size of each item, at most the slot item size.          *
+*   - wCount: Number of items to dequeue.                                 *
+* Returns: Number of items actually dequeued.                             *
+****************************************************************************/
+uint32_t mpmc_dequeue_items(mpmc_queue_t *ptObj, void *pItems, uint16_t hwItemSize, uint32_t wCount)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pItems);  // Ensure pItems is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    mpmc_queue_t *ptThis = (mpmc_queue_t *)ptObj;
+    assert(hwItemSize <= this.hwItemSize);  // The item must fit into a slot
+    uint8_t *pchItem = pItems;
+    uint32_t wDone = 0;
+
+    for (; wDone < wCount; wDone++) {
+        uint32_t *pwSequence;
+        uint32_t wPos = __atomic_load_n(&this.wHead, __ATOMIC_RELAXED);
+        for (;;) {
+            pwSequence = __mpmc_slot(wPos);
+            uint32_t wSequence = __atomic_load_n(pwSequence, __ATOMIC_ACQUIRE);
+            int32_t nDiff = (int32_t)(wSequence - (wPos + 1));
+            if (0 == nDiff) {  // The slot holds an item, try to claim it
+                if (__atomic_compare_exchange_n(&this.wHead, &wPos, wPos + 1, true,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (nDiff < 0) {  // The slot has not been filled yet
+                return wDone;  // Queue is empty
+            } else {  // Another consumer claimed the slot
+                wPos = __atomic_load_n(&this.wHead, __ATOMIC_RELAXED);
+            }
+        }
+        memcpy(&pchItem[wDone * hwItemSize], &pwSequence[1], hwItemSize);  // Copy item from slot
+        __atomic_store_n(pwSequence, wPos + this.wMask + 1, __ATOMIC_RELEASE);  // Free the slot for the next lap
+    }
+    return wDone;
+}
+
+/****************************************************************************
+* Function: is_mpmc_queue_empty                                           *
+* Description: Checks if the MPMC queue is empty. The answer is only a    *
+*              snapshot while other threads are running.                  *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the mpmc_queue_t object.                         *
+* Returns: True if the queue is empty, false otherwise.                  *
+****************************************************************************/
+bool is_mpmc_queue_empty(mpmc_queue_t *ptObj)
+{
+    return 0 == get_mpmc_queue_count(ptObj);
+}
+
+/****************************************************************************
+* Function: get_mpmc_queue_count                                          *
+* Description: Gets the number of claimed items in the MPMC queue. The    *
+*              answer is only a snapshot while other threads are running. *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the mpmc_queue_t object.                         *
+* Returns: Number of items in the queue.                                  *
+****************************************************************************/
+uint32_t get_mpmc_queue_count(mpmc_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    mpmc_queue_t *ptThis = (mpmc_queue_t *)ptObj;
+    uint32_t wHead = __atomic_load_n(&this.wHead, __ATOMIC_ACQUIRE);
+    uint32_t wTail = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE);
+    int32_t nCount = (int32_t)(wTail - wHead);
+    if (nCount < 0) {  // wHead was read before a producer/consumer pair moved on
+        return 0;
+    }
+    if ((uint32_t)nCount > this.wMask + 1) {
+        return this.wMask + 1;
+    }
+    return (uint32_t)nCount;
+}
@@ -0,0 +1,153 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+
+#ifndef QUEUE_MPMC_QUEUE_H_
+#define QUEUE_MPMC_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Size of one slot: a 32-bit sequence number followed by the item,
+ *        rounded up so the next sequence number stays aligned.
+ */
+#define MPMC_QUEUE_SLOT_SIZE(__ITEM_SIZE)                                      \
+    ((sizeof(uint32_t) + (__ITEM_SIZE) + sizeof(uint32_t) - 1)                 \
+        & ~(sizeof(uint32_t) - 1))
+
+/*!
+ * \brief Size of the buffer needed by a queue of __ITEM_COUNT items of
+ *        __ITEM_SIZE bytes each.
+ */
+#define MPMC_QUEUE_BUFFER_SIZE(__ITEM_SIZE, __ITEM_COUNT)                      \
+    (MPMC_QUEUE_SLOT_SIZE(__ITEM_SIZE) * (__ITEM_COUNT))
+
+#define __MPMC_DEQUEUE_0( __QUEUE, __ADDR)                                     \
+    mpmc_dequeue_items((__QUEUE), (__ADDR), (sizeof(typeof(*(__ADDR)))), 1)
+
+#define __MPMC_DEQUEUE_1( __QUEUE, __ADDR, __ITEM_COUNT)                       \
+    mpmc_dequeue_items((__QUEUE), (__ADDR), (sizeof(typeof((__ADDR[0])))), (__ITEM_COUNT))
+
+#define __MPMC_DEQUEUE_2( __QUEUE, __ADDR, __TYPE, __ITEM_COUNT)               \
+    mpmc_dequeue_items((__QUEUE), (__ADDR), (sizeof(__TYPE)), (__ITEM_COUNT))
+
+
+#define __MPMC_ENQUEUE_0( __QUEUE, __VALUE)                                    \
+    ({typeof((__VALUE)) SAFE_NAME(value) = __VALUE;                            \
+        mpmc_enqueue_items((__QUEUE), &(SAFE_NAME(value)), (sizeof(__VALUE)), 1);})
+
+#define __MPMC_ENQUEUE_1( __QUEUE, __ADDR, __ITEM_COUNT)                       \
+    mpmc_enqueue_items((__QUEUE), (__ADDR), (sizeof(typeof((__ADDR[0])))), (__ITEM_COUNT))
+
+#define __MPMC_ENQUEUE_2( __QUEUE, __ADDR, __TYPE, __ITEM_COUNT)               \
+    mpmc_enqueue_items((__QUEUE), (__ADDR), (sizeof(__TYPE)), (__ITEM_COUNT))
+
+/*!
+ * \brief Put items into the MPMC queue, one slot per item.
+ *
+ * \param[in] __queue pointer to the queue object.
+ * \param[in] __addr the item, or the address of an item array
+ * \param[in] ... Optional parameters,You can add data types and item quantities
+ *
+ * \return Return the number of items we put into the queue.
+ *
+ * \details The overloads are the same as enqueue(), but the size of the type
+ *          must not exceed the item size given to mpmc_queue_init().
+    E.g.
+    \code
+        uint32_t wSample = 0x55AAAA55;
+        uint32_t wSamples[8];
+        mpmc_enqueue(&my_queue, wSample);
+        mpmc_enqueue(&my_queue, wSamples, 8);
+        mpmc_enqueue(&my_queue, wSamples, uint32_t, 8);
+    \endcode
+ */
+#define mpmc_enqueue(__queue, __addr,...)                                      \
+    CONNECT2(__MPMC_ENQUEUE_,__PLOOC_VA_NUM_ARGS(__VA_ARGS__))                  \
+    (__queue,(__addr),##__VA_ARGS__)
+
+/*!
+ * \brief Get items from the MPMC queue, one slot per item.
+ *
+ * \param[in] __queue pointer to the queue object.
+ * \param[in] __addr address to the data buffer
+ * \param[in] ... Optional parameters,You can add data types and item quantities
+ *
+ * \return Return the number of items we read from the queue.
+ */
+#define mpmc_dequeue(__queue, __addr,...)                                      \
+    CONNECT2(__MPMC_DEQUEUE_,__PLOOC_VA_NUM_ARGS(__VA_ARGS__))                  \
+    (__queue,(__addr),##__VA_ARGS__)
+
+/*!
+ * \brief Bounded multi-producer/multi-consumer queue of fixed size items.
+ *
+ * \details Every slot carries a sequence number that tells producers and
+ *          consumers whose turn it is, so a slot is claimed with a single CAS
+ *          on wTail or wHead and no side ever waits for a lock. The item
+ *          count must be a power of two. The core needs 32-bit CAS support
+ *          (e.g. not Cortex-M0 without a libatomic).
+ */
+typedef struct mpmc_queue_t {
+    uint8_t *pchBuffer;
+    uint32_t wMask;
+    uint16_t hwItemSize;
+    uint16_t hwSlotSize;
+    __QUEUE_CACHE_ALIGNED uint32_t wTail;      /* claimed by producers */
+    __QUEUE_CACHE_ALIGNED uint32_t wHead;      /* claimed by consumers */
+} mpmc_queue_t;
+
+/*!
+ * \brief Initialize the MPMC queue object.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pBuffer slot storage of MPMC_QUEUE_BUFFER_SIZE() bytes.
+ * \param[in] hwItemSize size of one item in bytes.
+ * \param[in] wItemCount number of slots, must be a power of two.
+ *
+ * \return the address of queue item, or NULL on a bad parameter.
+ *
+ * \details Here is an example:
+    E.g.
+    \code
+        static uint8_t s_chBuffer[MPMC_QUEUE_BUFFER_SIZE(sizeof(uint32_t), 256)];
+        static mpmc_queue_t my_queue;
+        mpmc_queue_init(&my_queue, s_chBuffer, sizeof(uint32_t), 256);
+    \endcode
+ */
+extern
+mpmc_queue_t *mpmc_queue_init(mpmc_queue_t *ptObj, void *pBuffer, uint16_t hwItemSize, uint32_t wItemCount);
+
+extern
+uint32_t mpmc_enqueue_items(mpmc_queue_t *ptObj, const void *pItems, uint16_t hwItemSize, uint32_t wCount);
+
+extern
+uint32_t mpmc_dequeue_items(mpmc_queue_t *ptObj, void *pItems, uint16_t hwItemSize, uint32_t wCount);
+
+extern
+bool is_mpmc_queue_empty(mpmc_queue_t *ptObj);
+
+extern
+uint32_t get_mpmc_queue_count(mpmc_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_MPMC_QUEUE_H_ */
@@ -0,0 +1,197 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "overwrite_queue.h"
+#include <string.h>
+#undef this
+#define this        (*ptThis)
+
+/****************************************************************************
+* Function: overwrite_queue_init                                          *
+* Description: Initializes an overwrite queue object.                     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the overwrite_queue_t object to be initialized.  *
+*   - pBuffer: Pointer to the ring buffer.                                *
+*   - wSize: Size of the buffer in bytes, must be a power of two.         *
+* Returns: Pointer to the initialized overwrite_queue_t object or NULL.  *
+****************************************************************************/
+overwrite_queue_t *overwrite_queue_init(overwrite_queue_t *ptObj, void *pBuffer, uint32_t wSize)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    overwrite_queue_t *ptThis = (overwrite_queue_t *)ptObj;
+
+    if (pBuffer == NULL || wSize == 0 || 0 != (wSize & (wSize - 1)) || wSize > 0x80000000u) {
+        return NULL;
+    }
+    this.pchBuffer = pBuffer;
+    this.wMask = wSize - 1;
+    this.wWriting = 0;
+    this.wTail = 0;
+    this.wFill = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: overwrite_enqueue_bytes                                       *
+* Description: Appends bytes, writer side. wWriting is raised before the  *
+*              first byte is overwritten and wTail after the last one is  *
+*              written, so a reader that finds wWriting unchanged after   *
+*              its copy knows the copy is intact.                         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the overwrite_queue_t object.                    *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - wDataLength: Number of bytes to enqueue.                            *
+* Returns: wDataLength.                                                   *
+****************************************************************************/
+uint32_t overwrite_enqueue_bytes(overwrite_queue_t *ptObj, const void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    overwrite_queue_t *ptThis = (overwrite_queue_t *)ptObj;
+    const uint8_t *pchByte = pDate;
+    uint32_t wSize = this.wMask + 1;
+    uint32_t wEnd = this.wTail + wDataLength;  // wTail is owned by the writer
+    uint32_t wKeep = wDataLength;
+    if (wKeep > wSize) {  // Only the newest wSize bytes survive anyway
+        pchByte += wKeep - wSize;
+        wKeep = wSize;
+    }
+    if (0 == wKeep) {
+        return 0;
+    }
+    __atomic_store_n(&this.wWriting, wEnd, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // The claim is seen before any overwritten byte
+    uint32_t wIndex = (wEnd - wKeep) & this.wMask;
+    uint32_t wFirst = wSize - wIndex;
+    if (wKeep <= wFirst) {
+        memcpy(&this.pchBuffer[wIndex], pchByte, wKeep);  // Copy data to buffer
+    } else {
+        memcpy(&this.pchBuffer[wIndex], &pchByte[0], wFirst);  // Copy first part
+        memcpy(&this.pchBuffer[0], &pchByte[wFirst], wKeep - wFirst);  // Copy second part
+    }
+    __atomic_store_n(&this.wTail, wEnd, __ATOMIC_RELEASE);  // Publish the data
+    if (this.wFill < wSize) {  // After wTail, so a new wFill comes with its wTail
+        __atomic_store_n(&this.wFill, (wSize - this.wFill > wKeep) ? this.wFill + wKeep : wSize,
+                         __ATOMIC_RELEASE);
+    }
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: overwrite_reader_init                                         *
+* Description: Points a reader at the oldest byte held, or at the end of  *
+*              the stream. The writer stores wFill after wTail and wFill  *
+*              is read first, so the wTail seen is at least the one that  *
+*              goes with the wFill seen and the start is never before the *
+*              first byte written. Bytes overwritten while this runs show *
+*              up as an overrun on the first read.                        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the overwrite_queue_t object.                    *
+*   - ptReader: The cursor to set up.                                     *
+*   - bFromOldest: Start at the oldest byte instead of the end.           *
+* Returns: ptReader.                                                      *
+****************************************************************************/
+overwrite_reader_t *overwrite_reader_init(overwrite_queue_t *ptObj, overwrite_reader_t *ptReader, bool bFromOldest)
+{
+    assert(NULL != ptObj);
+    assert(NULL != ptReader);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    overwrite_queue_t *ptThis = (overwrite_queue_t *)ptObj;
+    uint32_t wFill = __atomic_load_n(&this.wFill, __ATOMIC_ACQUIRE);
+    uint32_t wTail = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE);
+    ptReader->wHead = bFromOldest ? wTail - wFill : wTail;
+    ptReader->wLost = 0;
+    return ptReader;
+}
+
+/****************************************************************************
+* Function: overwrite_dequeue_bytes                                       *
+* Description: Copies bytes through one reader's cursor, then validates   *
+*              the copy against wWriting. Bytes at stream offsets below   *
+*              wWriting - size may have been overwritten while they were  *
+*              copied; if the copy reaches down there it is discarded and *
+*              the cursor resynchronised to wWriting - size.              *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the overwrite_queue_t object.                    *
+*   - ptReader: The reader's cursor.                                      *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - wDataLength: Number of bytes to dequeue.                            *
+*   - ptOverrun: Receives the overrun report, may be NULL.                *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+uint32_t overwrite_dequeue_bytes(overwrite_queue_t *ptObj, overwrite_reader_t *ptReader,
+                                 void *pDate, uint32_t wDataLength, overwrite_overrun_t *ptOverrun)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != ptReader);  // Ensure ptReader is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    overwrite_queue_t *ptThis = (overwrite_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;
+    uint32_t wSize = this.wMask + 1;
+    uint32_t wHead = ptReader->wHead;
+    uint32_t wCount = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE) - wHead;
+    if (wCount > wSize) {
+        wCount = 0;  // Lapped already, the check below resyncs
+    }
+    if (wDataLength > wCount) {
+        wDataLength = wCount;
+    }
+    uint32_t wIndex = wHead & this.wMask;
+    uint32_t wFirst = wSize - wIndex;
+    if (wDataLength <= wFirst) {
+        memcpy(pchByte, &this.pchBuffer[wIndex], wDataLength);  // Copy data from buffer
+    } else {
+        memcpy(&pchByte[0], &this.pchBuffer[wIndex], wFirst);  // Copy first part
+        memcpy(&pchByte[wFirst], &this.pchBuffer[0], wDataLength - wFirst);  // Copy second part
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);  // The copy is done before wWriting is checked
+    uint32_t wWriting = __atomic_load_n(&this.wWriting, __ATOMIC_RELAXED);
+    overwrite_overrun_t tOverrun = {0, wHead};
+    if (wWriting - wHead > wSize) {  // The writer got to bytes we copied
+        tOverrun.wResync = wWriting - wSize;
+        tOverrun.wLost = tOverrun.wResync - wHead;
+        ptReader->wLost += tOverrun.wLost;
+        wHead = tOverrun.wResync;
+        wDataLength = 0;
+    }
+    ptReader->wHead = wHead + wDataLength;
+    if (NULL != ptOverrun) {
+        *ptOverrun = tOverrun;
+    }
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: get_overwrite_queue_count                                     *
+* Description: Gets the number of bytes the reader has not read yet.      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the overwrite_queue_t object.                    *
+*   - ptReader: The reader's cursor.                                      *
+* Returns: Unread bytes, at most the buffer size.                         *
+****************************************************************************/
+uint32_t get_overwrite_queue_count(overwrite_queue_t *ptObj, overwrite_reader_t *ptReader)
+{
+    assert(NULL != ptObj);
+    assert(NULL != ptReader);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    overwrite_queue_t *ptThis = (overwrite_queue_t *)ptObj;
+    uint32_t wCount = __atomic_load_n(&this.wTail, __ATOMIC_ACQUIRE) - ptReader->wHead;
+    return (wCount > this.wMask + 1) ? this.wMask + 1 : wCount;
+}
@@ -0,0 +1,131 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_OVERWRITE_QUEUE_H_
+#define QUEUE_OVERWRITE_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Cursor of one reader, private to the reading context.
+ */
+typedef struct overwrite_reader_t {
+    uint32_t wHead;                         /* stream offset of the next byte */
+    uint32_t wLost;                         /* bytes lost to overruns in total */
+} overwrite_reader_t;
+
+/*!
+ * \brief What a read that was overrun reports.
+ */
+typedef struct overwrite_overrun_t {
+    uint32_t wLost;                         /* bytes overwritten before they were read */
+    uint32_t wResync;                       /* stream offset reading went on from */
+} overwrite_overrun_t;
+
+/*!
+ * \brief Overwrite ring whose writer never waits, for flight recorders.
+ *
+ * \details Unlike cover mode of byte_queue_t, the writer never touches a
+ *          reader's state: it announces the stream offset it is about to
+ *          write up to in wWriting, copies, and publishes wTail. A reader
+ *          copies first and then checks wWriting; if the writer may have
+ *          overwritten any of the copied bytes meanwhile, the copy is thrown
+ *          away and the reader jumps to the oldest byte still intact
+ *          (seqlock style). Any number of readers may follow the stream, each
+ *          with its own cursor; the buffer size must be a power of two.
+ */
+typedef struct overwrite_queue_t {
+    uint8_t *pchBuffer;
+    uint32_t wMask;
+    __QUEUE_CACHE_ALIGNED uint32_t wWriting;   /* end of the write in progress */
+    uint32_t wTail;                         /* end of the published data */
+    uint32_t wFill;                         /* valid bytes, up to the buffer size */
+} overwrite_queue_t;
+
+/*!
+ * \brief Initialize the overwrite queue object.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] pBuffer address of the ring buffer.
+ * \param[in] wSize size of the ring buffer in bytes, must be a power of two.
+ *
+ * \return the address of queue item, or NULL on a bad parameter.
+    E.g.
+    \code
+        static uint8_t s_chTrace[8192];
+        static overwrite_queue_t s_tRecorder;
+        overwrite_queue_init(&s_tRecorder, s_chTrace, sizeof(s_chTrace));
+        overwrite_enqueue_bytes(&s_tRecorder, chEvent, sizeof(chEvent));  // never waits
+
+        overwrite_reader_t tDump;
+        overwrite_overrun_t tOverrun;
+        overwrite_reader_init(&s_tRecorder, &tDump, true);
+        hwLength = overwrite_dequeue_bytes(&s_tRecorder, &tDump, chOut, sizeof(chOut), &tOverrun);
+        if (0 != tOverrun.wLost) {
+            // tOverrun.wLost bytes are gone, the stream goes on at tOverrun.wResync
+        }
+    \endcode
+ */
+extern
+overwrite_queue_t *overwrite_queue_init(overwrite_queue_t *ptObj, void *pBuffer, uint32_t wSize);
+
+/*!
+ * \brief Append bytes, overwriting the oldest ones. Only one context may
+ *        write.
+ *
+ * \return wDataLength; of more than a buffer only the last wSize bytes are
+ *         kept.
+ */
+extern
+uint32_t overwrite_enqueue_bytes(overwrite_queue_t *ptObj, const void *pDate, uint32_t wDataLength);
+
+/*!
+ * \brief Point a reader at the oldest byte held, or at the end of the stream.
+ */
+extern
+overwrite_reader_t *overwrite_reader_init(overwrite_queue_t *ptObj, overwrite_reader_t *ptReader, bool bFromOldest);
+
+/*!
+ * \brief Read bytes through one reader's cursor.
+ *
+ * \param[in] ptObj pointer to the queue object.
+ * \param[in] ptReader the reader's cursor.
+ * \param[in] pDate address to the data buffer.
+ * \param[in] wDataLength size of the data buffer.
+ * \param[out] ptOverrun wLost is 0 unless the writer overran the reader, may
+ *             be NULL.
+ *
+ * \return Return the number of bytes read. An overrun returns 0 and moves
+ *         the cursor to ptOverrun->wResync; nothing torn is ever returned.
+ */
+extern
+uint32_t overwrite_dequeue_bytes(overwrite_queue_t *ptObj, overwrite_reader_t *ptReader,
+                                 void *pDate, uint32_t wDataLength, overwrite_overrun_t *ptOverrun);
+
+/*!
+ * \brief Number of bytes the reader has not read yet, up to the buffer size.
+ */
+extern
+uint32_t get_overwrite_queue_count(overwrite_queue_t *ptObj, overwrite_reader_t *ptReader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_OVERWRITE_QUEUE_H_ */
@@ -0,0 +1,281 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "prio_queue.h"
+#undef this
+#define this        (*ptThis)
+
+#define __PRIO_LANE_BIT(__LANE)     (0x80000000u >> (__LANE))
+
+typedef queue_size_t __prio_dequeue_t(byte_queue_t *ptObj, void *pDate, queue_size_t hwDataLength);
+
+/****************************************************************************
+* Function: prio_queue_init                                               *
+* Description: Initializes a priority queue set over existing lanes.      *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object to be initialized.       *
+*   - ptLanes: Array of initialized byte queues, lane 0 first.            *
+*   - chLaneCount: Number of lanes.                                       *
+* Returns: Pointer to the initialized prio_queue_t object or NULL.       *
+****************************************************************************/
+prio_queue_t *prio_queue_init(prio_queue_t *ptObj, byte_queue_t *ptLanes, uint8_t chLaneCount)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    prio_queue_t *ptThis = (prio_queue_t *)ptObj;
+
+    if (NULL == ptLanes || 0 == chLaneCount || chLaneCount > PRIO_QUEUE_MAX_LANES) {
+        return NULL;
+    }
+    this.ptLanes = ptLanes;
+    this.chLaneCount = chLaneCount;
+    this.wReady = 0;
+    this.wSpent = 0;
+    for (uint8_t i = 0; i < chLaneCount; i++) {
+        this.nCredit[i] = 0;
+        this.hwQuantum[i] = 0;
+        if (!is_queue_empty(&ptLanes[i])) {  // Lanes may already hold data
+            this.wReady |= __PRIO_LANE_BIT(i);
+        }
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: prio_queue_set_quantum                                        *
+* Description: Sets the bytes a lane may deliver per round.               *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object.                         *
+*   - chLane: The lane.                                                   *
+*   - hwQuantum: Bytes per round, 0 for strict priority.                  *
+* Returns: True if successful, false otherwise.                          *
+****************************************************************************/
+bool prio_queue_set_quantum(prio_queue_t *ptObj, uint8_t chLane, queue_size_t hwQuantum)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    prio_queue_t *ptThis = (prio_queue_t *)ptObj;
+
+    if (chLane >= this.chLaneCount) {
+        return false;
+    }
+    this.hwQuantum[chLane] = hwQuantum;
+    this.nCredit[chLane] = hwQuantum;
+    this.wSpent &= ~__PRIO_LANE_BIT(chLane);
+    return true;
+}
+
+/****************************************************************************
+* Function: __prio_mark_ready                                             *
+* Description: Producer side: sets the ready bit of a lane after data was *
+*              published. The fence pairs with the one in                 *
+*              __prio_account(), so a consumer clearing the bit           *
+*              concurrently either sees the data or the bit stays set.    *
+*              The bit is usually set already and then not written, which *
+*              keeps the shared line from bouncing.                       *
+****************************************************************************/
+static void __prio_mark_ready(prio_queue_t *ptThis, uint8_t chLane)
+{
+    uint32_t wBit = __PRIO_LANE_BIT(chLane);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (0 == (__atomic_load_n(&this.wReady, __ATOMIC_RELAXED) & wBit)) {
+        __atomic_fetch_or(&this.wReady, wBit, __ATOMIC_SEQ_CST);
+    }
+}
+
+/****************************************************************************
+* Function: __prio_select                                                 *
+* Description: Picks the most urgent ready lane that has quantum left.    *
+*              When every ready lane is out of quantum a new round        *
+*              starts.                                                    *
+* Returns: The lane, or PRIO_QUEUE_NO_LANE if no lane is ready.          *
+****************************************************************************/
+static uint8_t __prio_select(prio_queue_t *ptThis)
+{
+    uint32_t wReady = __atomic_load_n(&this.wReady, __ATOMIC_ACQUIRE);
+    if (0 == wReady) {
+        return PRIO_QUEUE_NO_LANE;
+    }
+    uint32_t wEligible = wReady & ~this.wSpent;
+    if (0 == wEligible) {  // Start a new round
+        this.wSpent = 0;
+        wEligible = wReady;
+    }
+    return (uint8_t)__builtin_clz(wEligible);
+}
+
+/****************************************************************************
+* Function: __prio_account                                                *
+* Description: Consumer side bookkeeping after hwDataLength bytes were    *
+*              taken from a lane: clears the ready bit of a drained lane  *
+*              and charges the lane's quantum.                            *
+* Returns: True if the lane was found empty.                              *
+****************************************************************************/
+static bool __prio_account(prio_queue_t *ptThis, uint8_t chLane, queue_size_t hwDataLength)
+{
+    uint32_t wBit = __PRIO_LANE_BIT(chLane);
+    if (is_queue_empty(&this.ptLanes[chLane])) {
+        __atomic_fetch_and(&this.wReady, ~wBit, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!is_queue_empty(&this.ptLanes[chLane])) {  // A producer raced us
+            __atomic_fetch_or(&this.wReady, wBit, __ATOMIC_SEQ_CST);
+        }
+        this.nCredit[chLane] = this.hwQuantum[chLane];  // An idle lane banks no credit
+        this.wSpent &= ~wBit;
+        return true;
+    }
+    if (0 != this.hwQuantum[chLane]) {
+        this.nCredit[chLane] -= hwDataLength;
+        if (this.nCredit[chLane] <= 0) {  // Let the lower lanes have their turn
+            this.nCredit[chLane] += this.hwQuantum[chLane];
+            this.wSpent |= wBit;
+        }
+    }
+    return false;
+}
+
+/****************************************************************************
+* Function: __prio_dequeue                                                *
+* Description: Takes data from the selected lane with fnDequeue. A ready  *
+*              bit may be stale, such a lane is cleared and the next one  *
+*              tried.                                                     *
+****************************************************************************/
+static queue_size_t __prio_dequeue(prio_queue_t *ptThis, uint8_t *pchLane, void *pDate,
+                                   queue_size_t hwDataLength, __prio_dequeue_t *fnDequeue)
+{
+    uint8_t chLane;
+    queue_size_t hwTaken;
+    do {
+        chLane = __prio_select(ptThis);
+        if (PRIO_QUEUE_NO_LANE == chLane) {
+            hwTaken = 0;
+            break;
+        }
+        hwTaken = fnDequeue(&this.ptLanes[chLane], pDate, hwDataLength);
+    } while (__prio_account(ptThis, chLane, hwTaken) && 0 == hwTaken);
+    if (NULL != pchLane) {
+        *pchLane = chLane;
+    }
+    return hwTaken;
+}
+
+/****************************************************************************
+* Function: prio_enqueue_bytes                                            *
+* Description: Enqueues bytes into one lane.                              *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object.                         *
+*   - chLane: The lane.                                                   *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - hwDataLength: Number of bytes to enqueue.                           *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+queue_size_t prio_enqueue_bytes(prio_queue_t *ptObj, uint8_t chLane, const void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    prio_queue_t *ptThis = (prio_queue_t *)ptObj;
+    if (chLane >= this.chLaneCount) {
+        return 0;
+    }
+    hwDataLength = enqueue_bytes(&this.ptLanes[chLane], (void *)pDate, hwDataLength);
+    if (hwDataLength > 0) {
+        __prio_mark_ready(ptThis, chLane);
+    }
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: prio_dequeue_bytes                                            *
+* Description: Dequeues bytes from the most urgent eligible lane.         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object.                         *
+*   - pchLane: Receives the lane, may be NULL.                            *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - hwDataLength: Number of bytes to dequeue.                           *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+queue_size_t prio_dequeue_bytes(prio_queue_t *ptObj, uint8_t *pchLane, void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    return __prio_dequeue((prio_queue_t *)ptObj, pchLane, pDate, hwDataLength, dequeue_bytes);
+}
+
+/****************************************************************************
+* Function: prio_enqueue_message                                          *
+* Description: Enqueues one message into one lane.                        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object.                         *
+*   - chLane: The lane.                                                   *
+*   - pDate: Pointer to the message.                                      *
+*   - hwDataLength: Length of the message.                                *
+* Returns: hwDataLength if the message was stored, 0 otherwise.           *
+****************************************************************************/
+queue_size_t prio_enqueue_message(prio_queue_t *ptObj, uint8_t chLane, const void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    prio_queue_t *ptThis = (prio_queue_t *)ptObj;
+    if (chLane >= this.chLaneCount) {
+        return 0;
+    }
+    hwDataLength = enqueue_message(&this.ptLanes[chLane], pDate, hwDataLength);
+    if (hwDataLength > 0) {
+        __prio_mark_ready(ptThis, chLane);
+    }
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: prio_dequeue_message                                          *
+* Description: Dequeues one message from the most urgent eligible lane.   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object.                         *
+*   - pchLane: Receives the lane, may be NULL.                            *
+*   - pDate: Buffer receiving the message.                                *
+*   - hwBufferSize: Size of that buffer.                                  *
+* Returns: Length of the message, or 0 if none was removed.              *
+****************************************************************************/
+queue_size_t prio_dequeue_message(prio_queue_t *ptObj, uint8_t *pchLane, void *pDate, queue_size_t hwBufferSize)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    return __prio_dequeue((prio_queue_t *)ptObj, pchLane, pDate, hwBufferSize, dequeue_message);
+}
+
+/****************************************************************************
+* Function: is_prio_queue_empty                                           *
+* Description: Checks if every lane is empty.                             *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the prio_queue_t object.                         *
+* Returns: True if all lanes are empty, false otherwise.                 *
+****************************************************************************/
+bool is_prio_queue_empty(prio_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    prio_queue_t *ptThis = (prio_queue_t *)ptObj;
+    uint32_t wReady = __atomic_load_n(&this.wReady, __ATOMIC_ACQUIRE);
+    while (0 != wReady) {  // Only lanes marked ready can hold data
+        uint8_t chLane = (uint8_t)__builtin_clz(wReady);
+        if (!is_queue_empty(&this.ptLanes[chLane])) {
+            return false;
+        }
+        wReady &= ~__PRIO_LANE_BIT(chLane);
+    }
+    return true;
+}
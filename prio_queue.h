@@ -0,0 +1,131 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_PRIO_QUEUE_H_
+#define QUEUE_PRIO_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRIO_QUEUE_MAX_LANES    32
+#define PRIO_QUEUE_NO_LANE      0xFF            /* *pchLane when no lane was ready */
+
+/*!
+ * \brief A set of byte queues ("lanes") drained in priority order, lane 0
+ *        first.
+ *
+ * \details wReady holds bit (31 - n) while lane n may hold data, so the most
+ *          urgent ready lane is one count-leading-zeros away. A lane with a
+ *          quantum only gets that many bytes per round while lower lanes wait
+ *          (deficit round robin); lanes without one are served strictly by
+ *          priority.
+ */
+typedef struct prio_queue_t {
+    byte_queue_t *ptLanes;
+    uint8_t chLaneCount;
+    __QUEUE_CACHE_ALIGNED
+    uint32_t wReady;                            /* shared by all producers */
+    __QUEUE_CACHE_ALIGNED
+    uint32_t wSpent;                            /* consumer side: lanes out of quantum */
+    int32_t nCredit[PRIO_QUEUE_MAX_LANES];
+    queue_size_t hwQuantum[PRIO_QUEUE_MAX_LANES];
+} prio_queue_t;
+
+/*!
+ * \brief Initialize a priority queue set over already initialized lanes.
+ *
+ * \param[in] ptObj pointer to the queue set object.
+ * \param[in] ptLanes array of lanes, lane 0 is the most urgent. Each lane may
+ *            use any mode (locked, SPSC, message, ...).
+ * \param[in] chLaneCount number of lanes, 1 to PRIO_QUEUE_MAX_LANES.
+ *
+ * \return the address of the queue set, or NULL on failure.
+    E.g.
+    \code
+        static byte_queue_t s_tLanes[3];
+        static prio_queue_t s_tLink;
+        queue_init_message(&s_tLanes[0], s_chCtrl, sizeof(s_chCtrl), false);
+        queue_init_spsc(&s_tLanes[1], s_chBulkHi, sizeof(s_chBulkHi));
+        queue_init_spsc(&s_tLanes[2], s_chBulkLo, sizeof(s_chBulkLo));
+        prio_queue_init(&s_tLink, s_tLanes, 3);
+        prio_queue_set_quantum(&s_tLink, 1, 3072);      // 3:1 against lane 2
+        prio_queue_set_quantum(&s_tLink, 2, 1024);
+
+        uint8_t chLane;
+        hwLength = prio_dequeue_bytes(&s_tLink, &chLane, chBuf, sizeof(chBuf));
+    \endcode
+ */
+extern
+prio_queue_t *prio_queue_init(prio_queue_t *ptObj, byte_queue_t *ptLanes, uint8_t chLaneCount);
+
+/*!
+ * \brief Limit a lane to hwQuantum bytes per round, 0 for strict priority.
+ *
+ * \details Call it from the consumer thread. A lane without quantum is never
+ *          held back, so keep those for small, latency critical traffic.
+ */
+extern
+bool prio_queue_set_quantum(prio_queue_t *ptObj, uint8_t chLane, queue_size_t hwQuantum);
+
+/*!
+ * \brief Put data into one lane and mark the lane ready.
+ */
+extern
+queue_size_t prio_enqueue_bytes(prio_queue_t *ptObj, uint8_t chLane, const void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Get data from the most urgent lane that is ready and has quantum
+ *        left.
+ *
+ * \param[in] ptObj pointer to the queue set object.
+ * \param[out] pchLane receives the lane the data came from, may be NULL.
+ * \param[in] pDate address to the data buffer.
+ * \param[in] hwDataLength size of the data buffer.
+ *
+ * \return Return the number of bytes taken from that one lane, 0 if every lane
+ *         is empty or the chosen lane is busy.
+ *
+ * \details The consumer side state is not locked: call it from one thread.
+ */
+extern
+queue_size_t prio_dequeue_bytes(prio_queue_t *ptObj, uint8_t *pchLane, void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Put one message into a lane set up with queue_init_message().
+ */
+extern
+queue_size_t prio_enqueue_message(prio_queue_t *ptObj, uint8_t chLane, const void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Get one message from the most urgent ready lane.
+ *
+ * \return Return the length of the message, or 0. If *pchLane is not
+ *         PRIO_QUEUE_NO_LANE on a 0 return, that lane's next message did not
+ *         fit or the lane was busy, see get_queue_message_size().
+ */
+extern
+queue_size_t prio_dequeue_message(prio_queue_t *ptObj, uint8_t *pchLane, void *pDate, queue_size_t hwBufferSize);
+
+extern
+bool is_prio_queue_empty(prio_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_PRIO_QUEUE_H_ */
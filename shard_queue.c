@@ -0,0 +1,396 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "shard_queue.h"
+#undef this
+#define this        (*ptThis)
+
+#if defined(__unix__) || defined(__APPLE__)
+typedef struct shard_local_t {
+    shard_queue_t *ptQueue;
+    shard_t *ptShard;
+} shard_local_t;
+
+static __thread shard_local_t s_tLocal[SHARD_QUEUE_LOCAL_SLOTS];
+#endif
+
+/****************************************************************************
+* Function: shard_queue_init                                              *
+* Description: Initializes a shard queue and one SPSC ring per shard.     *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object to be initialized.      *
+*   - ptShards: Array of hwShardCount shards.                             *
+*   - hwShardCount: Number of shards.                                     *
+*   - pBuffer: Storage of all shards, hwShardSize bytes each.             *
+*   - hwShardSize: Ring size of one shard.                                *
+* Returns: Pointer to the initialized shard_queue_t object or NULL.      *
+****************************************************************************/
+shard_queue_t *shard_queue_init(shard_queue_t *ptObj, shard_t *ptShards, uint16_t hwShardCount,
+                                void *pBuffer, queue_size_t hwShardSize)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+
+    if (NULL == ptShards || NULL == pBuffer || 0 == hwShardCount
+     || SHARD_QUEUE_NO_SHARD == hwShardCount || 0 == hwShardSize) {
+        return NULL;
+    }
+    for (uint16_t i = 0; i < hwShardCount; i++) {
+        if (NULL == queue_init_spsc(&ptShards[i].tQueue,
+                                    (uint8_t *)pBuffer + (size_t)i * hwShardSize, hwShardSize)) {
+            return NULL;
+        }
+        ptShards[i].bAttached = false;
+        ptShards[i].bHeadValid = false;
+        ptShards[i].hwHeadLength = 0;
+        ptShards[i].dwHeadStamp = 0;
+    }
+    this.ptShards = ptShards;
+    this.hwShardCount = hwShardCount;
+    this.hwCursor = 0;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: shard_queue_attach                                            *
+* Description: Claims the first free shard. The acquire CAS pairs with    *
+*              the release store in shard_queue_detach(), so the producer *
+*              side of the ring is handed over intact.                    *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+* Returns: The claimed shard, or NULL if all are attached.               *
+****************************************************************************/
+shard_t *shard_queue_attach(shard_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+
+    for (uint16_t i = 0; i < this.hwShardCount; i++) {
+        shard_t *ptShard = &this.ptShards[i];
+        bool bFree = false;
+        if (!__atomic_load_n(&ptShard->bAttached, __ATOMIC_RELAXED)
+         && __atomic_compare_exchange_n(&ptShard->bAttached, &bFree, true, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return ptShard;
+        }
+    }
+    return NULL;
+}
+
+/****************************************************************************
+* Function: shard_queue_detach                                            *
+* Description: Gives a shard back for another producer to claim.          *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+*   - ptShard: The shard returned by shard_queue_attach().                *
+* Returns: True if successful, false otherwise.                          *
+****************************************************************************/
+bool shard_queue_detach(shard_queue_t *ptObj, shard_t *ptShard)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+
+    if (NULL == ptShard || ptShard < this.ptShards || ptShard >= &this.ptShards[this.hwShardCount]) {
+        return false;
+    }
+    __atomic_store_n(&ptShard->bAttached, false, __ATOMIC_RELEASE);
+    return true;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/****************************************************************************
+* Function: shard_queue_local                                             *
+* Description: Looks the calling thread's shard up in its thread-local    *
+*              cache and attaches one on a miss.                          *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+* Returns: The thread's shard, or NULL.                                   *
+****************************************************************************/
+shard_t *shard_queue_local(shard_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    shard_local_t *ptFree = NULL;
+    for (uint16_t i = 0; i < SHARD_QUEUE_LOCAL_SLOTS; i++) {
+        if (ptObj == s_tLocal[i].ptQueue) {
+            return s_tLocal[i].ptShard;
+        }
+        if (NULL == ptFree && NULL == s_tLocal[i].ptQueue) {
+            ptFree = &s_tLocal[i];
+        }
+    }
+    if (NULL == ptFree) {
+        return NULL;  // Use shard_queue_attach() directly
+    }
+    shard_t *ptShard = shard_queue_attach(ptObj);
+    if (NULL != ptShard) {
+        ptFree->ptQueue = ptObj;
+        ptFree->ptShard = ptShard;
+    }
+    return ptShard;
+}
+
+/****************************************************************************
+* Function: shard_queue_local_detach                                      *
+* Description: Detaches the calling thread's shard and drops it from the  *
+*              thread-local cache.                                        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+* Returns: True if the thread had a shard, false otherwise.              *
+****************************************************************************/
+bool shard_queue_local_detach(shard_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    for (uint16_t i = 0; i < SHARD_QUEUE_LOCAL_SLOTS; i++) {
+        if (ptObj == s_tLocal[i].ptQueue) {
+            shard_t *ptShard = s_tLocal[i].ptShard;
+            s_tLocal[i].ptQueue = NULL;
+            s_tLocal[i].ptShard = NULL;
+            return shard_queue_detach(ptObj, ptShard);
+        }
+    }
+    return false;
+}
+#endif
+
+/****************************************************************************
+* Function: shard_enqueue_bytes                                           *
+* Description: Enqueues bytes into the producer's own shard.              *
+* Parameters:                                                             *
+*   - ptShard: The producer's shard.                                      *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - hwDataLength: Number of bytes to enqueue.                           *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+queue_size_t shard_enqueue_bytes(shard_t *ptShard, const void *pDate, queue_size_t hwDataLength)
+{
+    if (NULL == ptShard) {
+        return 0;  // Lets shard_queue_local() be passed in unchecked
+    }
+    return enqueue_bytes(&ptShard->tQueue, (void *)pDate, hwDataLength);
+}
+
+/****************************************************************************
+* Function: shard_dequeue_bytes                                           *
+* Description: Dequeues bytes from the next non-empty shard, starting     *
+*              after the shard served last.                               *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+*   - phwShard: Receives the shard, may be NULL.                          *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - hwDataLength: Number of bytes to dequeue.                           *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+queue_size_t shard_dequeue_bytes(shard_queue_t *ptObj, uint16_t *phwShard, void *pDate, queue_size_t hwDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+
+    uint16_t hwShard = this.hwCursor;
+    for (uint16_t n = 0; n < this.hwShardCount; n++) {
+        queue_size_t hwTaken = dequeue_bytes(&this.ptShards[hwShard].tQueue, pDate, hwDataLength);
+        uint16_t hwNext = (hwShard + 1 == this.hwShardCount) ? 0 : hwShard + 1;
+        if (hwTaken > 0) {
+            this.hwCursor = hwNext;
+            if (NULL != phwShard) {
+                *phwShard = hwShard;
+            }
+            return hwTaken;
+        }
+        hwShard = hwNext;
+    }
+    if (NULL != phwShard) {
+        *phwShard = SHARD_QUEUE_NO_SHARD;
+    }
+    return 0;
+}
+
+/****************************************************************************
+* Function: shard_queue_drain                                             *
+* Description: Passes the data of every non-empty shard to fnHandler in   *
+*              place and removes what it consumed.                        *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+*   - fnHandler: Called once per non-empty shard.                         *
+*   - pTarget: Passed to fnHandler.                                       *
+* Returns: Total number of bytes consumed.                                *
+****************************************************************************/
+queue_size_t shard_queue_drain(shard_queue_t *ptObj, shard_drain_handler_t *fnHandler, void *pTarget)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != fnHandler);  // Ensure fnHandler is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+
+    queue_size_t hwTotal = 0;
+    for (uint16_t i = 0; i < this.hwShardCount; i++) {
+        queue_span_t tSpan[2];
+        byte_queue_t *ptQueue = &this.ptShards[i].tQueue;
+        if (0 == dequeue_acquire(ptQueue, tSpan)) {
+            continue;
+        }
+        hwTotal += dequeue_release(ptQueue, fnHandler(pTarget, i, tSpan));
+    }
+    return hwTotal;
+}
+
+/****************************************************************************
+* Function: shard_enqueue_stamped                                         *
+* Description: Enqueues one record as [length][stamp][payload]. The three *
+*              parts are published together, so the consumer never sees a *
+*              header without its payload.                                *
+* Parameters:                                                             *
+*   - ptShard: The producer's shard.                                      *
+*   - dwStamp: Time stamp of the record.                                  *
+*   - pDate: Pointer to the record.                                       *
+*   - hwDataLength: Length of the record.                                 *
+* Returns: hwDataLength if the record was stored, 0 otherwise.           *
+****************************************************************************/
+queue_size_t shard_enqueue_stamped(shard_t *ptShard, uint64_t dwStamp, const void *pDate, queue_size_t hwDataLength)
+{
+    if (NULL == ptShard || NULL == pDate || 0 == hwDataLength) {
+        return 0;
+    }
+    queue_iovec_t tRecord[] = {
+        {&hwDataLength, sizeof(hwDataLength)},
+        {&dwStamp, sizeof(dwStamp)},
+        {(void *)pDate, hwDataLength},
+    };
+    if (0 == enqueue_bytes_v(&ptShard->tQueue, tRecord, 3)) {
+        return 0;
+    }
+    return hwDataLength;
+}
+
+/****************************************************************************
+* Function: __shard_oldest                                                *
+* Description: Takes the header of every shard's next record into the     *
+*              shard (once per record) and picks the oldest stamp. Ties   *
+*              go to the lower shard.                                     *
+* Returns: The shard holding the oldest record, or NULL.                  *
+****************************************************************************/
+static shard_t *__shard_oldest(shard_queue_t *ptThis)
+{
+    shard_t *ptOldest = NULL;
+    for (uint16_t i = 0; i < this.hwShardCount; i++) {
+        shard_t *ptShard = &this.ptShards[i];
+        if (!ptShard->bHeadValid) {
+            queue_iovec_t tHeader[] = {
+                {&ptShard->hwHeadLength, sizeof(ptShard->hwHeadLength)},
+                {&ptShard->dwHeadStamp, sizeof(ptShard->dwHeadStamp)},
+            };
+            if (0 == dequeue_bytes_v(&ptShard->tQueue, tHeader, 2)) {
+                continue;
+            }
+            ptShard->bHeadValid = true;
+        }
+        if (NULL == ptOldest || ptShard->dwHeadStamp < ptOldest->dwHeadStamp) {
+            ptOldest = ptShard;
+        }
+    }
+    return ptOldest;
+}
+
+/****************************************************************************
+* Function: shard_dequeue_stamped                                         *
+* Description: Dequeues the record with the oldest stamp of all shards.   *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+*   - pdwStamp: Receives the stamp, may be NULL.                          *
+*   - pDate: Buffer receiving the record.                                 *
+*   - hwBufferSize: Size of that buffer.                                  *
+* Returns: Length of the record, or 0 if none was removed.               *
+****************************************************************************/
+queue_size_t shard_dequeue_stamped(shard_queue_t *ptObj, uint64_t *pdwStamp, void *pDate, queue_size_t hwBufferSize)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+
+    shard_t *ptShard = __shard_oldest(ptThis);
+    if (NULL == ptShard || ptShard->hwHeadLength > hwBufferSize) {
+        return 0;
+    }
+    /* the payload was published with the header, so it is all there */
+    queue_size_t hwLength = dequeue_bytes(&ptShard->tQueue, pDate, ptShard->hwHeadLength);
+    ptShard->bHeadValid = false;
+    if (NULL != pdwStamp) {
+        *pdwStamp = ptShard->dwHeadStamp;
+    }
+    return hwLength;
+}
+
+/****************************************************************************
+* Function: get_shard_stamped_size                                        *
+* Description: Gets the length of the oldest stamped record.              *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+* Returns: Length of that record, 0 if there is none.                     *
+****************************************************************************/
+queue_size_t get_shard_stamped_size(shard_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    shard_t *ptShard = __shard_oldest((shard_queue_t *)ptObj);
+    return (NULL == ptShard) ? 0 : ptShard->hwHeadLength;
+}
+
+/****************************************************************************
+* Function: is_shard_queue_empty                                          *
+* Description: Checks if every shard is empty.                            *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+* Returns: True if all shards are empty, false otherwise.                *
+****************************************************************************/
+bool is_shard_queue_empty(shard_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+    for (uint16_t i = 0; i < this.hwShardCount; i++) {
+        if (this.ptShards[i].bHeadValid || !is_queue_empty(&this.ptShards[i].tQueue)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/****************************************************************************
+* Function: get_shard_queue_count                                         *
+* Description: Sums the bytes held by all shards.                         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shard_queue_t object.                        *
+* Returns: Number of bytes queued.                                        *
+****************************************************************************/
+queue_size_t get_shard_queue_count(shard_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shard_queue_t *ptThis = (shard_queue_t *)ptObj;
+    queue_size_t hwCount = 0;
+    for (uint16_t i = 0; i < this.hwShardCount; i++) {
+        hwCount += get_queue_count(&this.ptShards[i].tQueue);
+        if (this.ptShards[i].bHeadValid) {  // Header already taken out
+            hwCount += sizeof(queue_size_t) + sizeof(uint64_t);
+        }
+    }
+    return hwCount;
+}
@@ -0,0 +1,221 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_SHARD_QUEUE_H_
+#define QUEUE_SHARD_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Per-thread shard cache entries kept by shard_queue_local(), i.e. the
+ *        number of shard queues one thread may write through it.
+ */
+#ifndef SHARD_QUEUE_LOCAL_SLOTS
+#   define SHARD_QUEUE_LOCAL_SLOTS     4
+#endif
+
+#define SHARD_QUEUE_NO_SHARD        0xFFFF      /* *phwShard when nothing was taken */
+
+/*!
+ * \brief One producer's private SPSC ring.
+ *
+ * \details Once attached, the producer only writes the producer side of tQueue,
+ *          so producers never share a cache line with each other. The fields
+ *          after tQueue are written by the consumer, apart from bAttached.
+ */
+typedef struct shard_t {
+    byte_queue_t tQueue;
+    __QUEUE_CACHE_ALIGNED
+    bool bAttached;                             /* claimed by a producer */
+    bool bHeadValid;                            /* consumer holds the next header */
+    queue_size_t hwHeadLength;                  /* payload length of that record */
+    uint64_t dwHeadStamp;                       /* and its time stamp */
+} shard_t;
+
+/*!
+ * \brief A set of shards drained by one consumer.
+ */
+typedef struct shard_queue_t {
+    shard_t *ptShards;
+    uint16_t hwShardCount;
+    uint16_t hwCursor;                          /* consumer: next shard to serve */
+} shard_queue_t;
+
+/*!
+ * \brief Called by shard_queue_drain() with the data held by one shard.
+ *
+ * \param[in] pTarget the pointer given to shard_queue_drain().
+ * \param[in] hwShard index of the shard.
+ * \param[in] tSpan the data, the second span is empty unless it wraps.
+ *
+ * \return Return the number of bytes consumed, from the front.
+ */
+typedef queue_size_t shard_drain_handler_t(void *pTarget, uint16_t hwShard, const queue_span_t tSpan[2]);
+
+/*!
+ * \brief Initialize a shard queue.
+ *
+ * \param[in] ptObj pointer to the shard queue object.
+ * \param[in] ptShards array of hwShardCount shards.
+ * \param[in] hwShardCount number of shards, i.e. the most producers attached
+ *            at the same time.
+ * \param[in] pBuffer hwShardCount * hwShardSize bytes, shard n uses the n-th
+ *            hwShardSize bytes.
+ * \param[in] hwShardSize ring size of each shard.
+ *
+ * \return the address of the shard queue, or NULL on failure.
+    E.g.
+    \code
+        static shard_t s_tShards[8];
+        static uint8_t s_chShardBuffer[8][4096];
+        static shard_queue_t s_tLog;
+        shard_queue_init(&s_tLog, s_tShards, 8, s_chShardBuffer, 4096);
+
+        // any producer thread
+        shard_enqueue_bytes(shard_queue_local(&s_tLog), chLine, hwLength);
+
+        // the consumer
+        hwLength = shard_dequeue_bytes(&s_tLog, NULL, chBuf, sizeof(chBuf));
+    \endcode
+ */
+extern
+shard_queue_t *shard_queue_init(shard_queue_t *ptObj, shard_t *ptShards, uint16_t hwShardCount,
+                                void *pBuffer, queue_size_t hwShardSize);
+
+/*!
+ * \brief Claim a free shard for the calling producer.
+ *
+ * \return the shard, or NULL if every shard is attached.
+ *
+ * \details This is the only producer call that touches shared state. Data a
+ *          previous owner left behind is still delivered before new data.
+ */
+extern
+shard_t *shard_queue_attach(shard_queue_t *ptObj);
+
+/*!
+ * \brief Give a shard back. Queued data is still drained by the consumer.
+ */
+extern
+bool shard_queue_detach(shard_queue_t *ptObj, shard_t *ptShard);
+
+#if defined(__unix__) || defined(__APPLE__)
+/*!
+ * \brief Get the calling thread's shard, attaching one on first use.
+ *
+ * \return the shard, or NULL if every shard is attached or the thread already
+ *         uses SHARD_QUEUE_LOCAL_SLOTS shard queues.
+ *
+ * \details The shard stays attached when the thread exits; call
+ *          shard_queue_local_detach() first if threads come and go.
+ */
+extern
+shard_t *shard_queue_local(shard_queue_t *ptObj);
+
+/*!
+ * \brief Detach the calling thread's shard, if it has one.
+ */
+extern
+bool shard_queue_local_detach(shard_queue_t *ptObj);
+#endif
+
+/*!
+ * \brief Put data into the producer's own shard. Only the owner may call it.
+ */
+extern
+queue_size_t shard_enqueue_bytes(shard_t *ptShard, const void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Get data from the next non-empty shard, round robin.
+ *
+ * \param[in] ptObj pointer to the shard queue object.
+ * \param[out] phwShard receives the shard the data came from, may be NULL.
+ * \param[in] pDate address to the data buffer.
+ * \param[in] hwDataLength size of the data buffer.
+ *
+ * \return Return the number of bytes taken from that one shard, so data of
+ *         different producers is never mixed in one call.
+ *
+ * \details The consumer side is not locked: call it from one thread.
+ */
+extern
+queue_size_t shard_dequeue_bytes(shard_queue_t *ptObj, uint16_t *phwShard, void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Hand everything queued to fnHandler, one call per non-empty shard,
+ *        without copying.
+ *
+ * \return Return the total number of bytes consumed.
+ */
+extern
+queue_size_t shard_queue_drain(shard_queue_t *ptObj, shard_drain_handler_t *fnHandler, void *pTarget);
+
+/*!
+ * \brief Put one record with a time stamp into the producer's own shard.
+ *
+ * \param[in] ptShard the producer's shard.
+ * \param[in] dwStamp time stamp, not decreasing within one shard, e.g.
+ *            CLOCK_MONOTONIC nanoseconds or a shared cycle counter.
+ * \param[in] pDate the record.
+ * \param[in] hwDataLength length of the record.
+ *
+ * \return hwDataLength if the record was stored, 0 otherwise.
+ *
+ * \details A shard carries either stamped records or plain bytes, never both.
+ */
+extern
+queue_size_t shard_enqueue_stamped(shard_t *ptShard, uint64_t dwStamp, const void *pDate, queue_size_t hwDataLength);
+
+/*!
+ * \brief Get the queued record with the oldest time stamp.
+ *
+ * \param[in] ptObj pointer to the shard queue object.
+ * \param[out] pdwStamp receives the record's time stamp, may be NULL.
+ * \param[in] pDate address to the data buffer.
+ * \param[in] hwBufferSize size of the data buffer.
+ *
+ * \return Return the length of the record, or 0 if there is none or it does
+ *         not fit, see get_shard_stamped_size().
+ *
+ * \details The merge only orders what is queued: a record published later
+ *          with an older stamp is delivered late, not reordered.
+ */
+extern
+queue_size_t shard_dequeue_stamped(shard_queue_t *ptObj, uint64_t *pdwStamp, void *pDate, queue_size_t hwBufferSize);
+
+/*!
+ * \brief Get the length of the record shard_dequeue_stamped() returns next.
+ */
+extern
+queue_size_t get_shard_stamped_size(shard_queue_t *ptObj);
+
+extern
+bool is_shard_queue_empty(shard_queue_t *ptObj);
+
+/*!
+ * \brief Get the number of bytes held by all shards, headers included.
+ */
+extern
+queue_size_t get_shard_queue_count(shard_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_SHARD_QUEUE_H_ */
@@ -0,0 +1,265 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#include "shm_queue.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#undef this
+#define this        (*ptThis)
+
+#define SHM_QUEUE_MAGIC         0x51484D53u     /* "SMHQ" */
+
+/* the data area starts on its own cache line behind the control block */
+#define __SHM_QUEUE_DATA_OFFSET                                                \
+    ((sizeof(shm_queue_ctrl_t) + 63u) & ~(size_t)63u)
+
+/****************************************************************************
+* Function: __shm_queue_map                                               *
+* Description: Maps a shared memory object and fills in the handle.       *
+****************************************************************************/
+static shm_queue_t *__shm_queue_map(shm_queue_t *ptThis, int nFd, size_t tMapSize)
+{
+    void *pBase = mmap(NULL, tMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+    if (MAP_FAILED == pBase) {
+        return NULL;
+    }
+    this.ptCtrl = pBase;
+    this.pchBuffer = (uint8_t *)pBase + __SHM_QUEUE_DATA_OFFSET;
+    this.tMapSize = tMapSize;
+    return ptThis;
+}
+
+/****************************************************************************
+* Function: shm_queue_create                                              *
+* Description: Creates and maps a named shared memory byte queue.         *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle to be initialized.        *
+*   - pchName: Name of the shared memory object.                          *
+*   - wSize: Size of the data area, must be a power of two.               *
+* Returns: Pointer to the initialized shm_queue_t handle or NULL.        *
+****************************************************************************/
+shm_queue_t *shm_queue_create(shm_queue_t *ptObj, const char *pchName, uint32_t wSize)
+{
+    assert(NULL != ptObj);
+    assert(NULL != pchName);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shm_queue_t *ptThis = (shm_queue_t *)ptObj;
+
+    if (wSize == 0 || 0 != (wSize & (wSize - 1))) {
+        return NULL;
+    }
+    int nFd = shm_open(pchName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (nFd < 0) {
+        return NULL;
+    }
+    size_t tMapSize = __SHM_QUEUE_DATA_OFFSET + wSize;
+    if (0 != ftruncate(nFd, (off_t)tMapSize) || NULL == __shm_queue_map(ptThis, nFd, tMapSize)) {
+        close(nFd);
+        shm_unlink(pchName);
+        return NULL;
+    }
+    close(nFd);  // The mapping keeps the object alive
+
+    /* a fresh object reads as zero, only the geometry has to be filled in */
+    this.ptCtrl->wSize = wSize;
+    this.ptCtrl->wDataOffset = __SHM_QUEUE_DATA_OFFSET;
+    this.ptCtrl->wTail = 0;
+    this.ptCtrl->wHead = 0;
+    this.wMask = wSize - 1;
+    __atomic_store_n(&this.ptCtrl->wMagic, SHM_QUEUE_MAGIC, __ATOMIC_RELEASE);  // Publish the queue
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: shm_queue_attach                                              *
+* Description: Maps a shared memory byte queue created by another process.*
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle to be initialized.        *
+*   - pchName: Name of the shared memory object.                          *
+* Returns: Pointer to the initialized shm_queue_t handle or NULL.        *
+****************************************************************************/
+shm_queue_t *shm_queue_attach(shm_queue_t *ptObj, const char *pchName)
+{
+    assert(NULL != ptObj);
+    assert(NULL != pchName);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shm_queue_t *ptThis = (shm_queue_t *)ptObj;
+
+    int nFd = shm_open(pchName, O_RDWR, 0);
+    if (nFd < 0) {
+        return NULL;
+    }
+    struct stat tStat;
+    if (0 != fstat(nFd, &tStat) || (size_t)tStat.st_size <= __SHM_QUEUE_DATA_OFFSET
+    ||  NULL == __shm_queue_map(ptThis, nFd, (size_t)tStat.st_size)) {
+        close(nFd);
+        return NULL;
+    }
+    close(nFd);
+
+    shm_queue_ctrl_t *ptCtrl = this.ptCtrl;
+    if (SHM_QUEUE_MAGIC != __atomic_load_n(&ptCtrl->wMagic, __ATOMIC_ACQUIRE)  // Not created yet
+    ||  __SHM_QUEUE_DATA_OFFSET != ptCtrl->wDataOffset  // Different layout
+    ||  __SHM_QUEUE_DATA_OFFSET + ptCtrl->wSize != this.tMapSize) {
+        munmap(this.ptCtrl, this.tMapSize);
+        this.ptCtrl = NULL;
+        return NULL;
+    }
+    this.wMask = ptCtrl->wSize - 1;
+    return ptObj;
+}
+
+/****************************************************************************
+* Function: shm_queue_detach                                              *
+* Description: Unmaps a shared memory byte queue from this process.       *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle.                          *
+* Returns: True on success, false otherwise.                             *
+****************************************************************************/
+bool shm_queue_detach(shm_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shm_queue_t *ptThis = (shm_queue_t *)ptObj;
+    if (NULL == this.ptCtrl || 0 != munmap(this.ptCtrl, this.tMapSize)) {
+        return false;
+    }
+    this.ptCtrl = NULL;
+    this.pchBuffer = NULL;
+    return true;
+}
+
+/****************************************************************************
+* Function: shm_queue_destroy                                             *
+* Description: Removes the name of a shared memory byte queue.            *
+* Parameters:                                                             *
+*   - pchName: Name of the shared memory object.                          *
+* Returns: True on success, false otherwise.                             *
+****************************************************************************/
+bool shm_queue_destroy(const char *pchName)
+{
+    assert(NULL != pchName);
+    return 0 == shm_unlink(pchName);
+}
+
+/****************************************************************************
+* Function: shm_enqueue_bytes                                             *
+* Description: Enqueues bytes, producer side. Only wTail is written, the  *
+*              consumer's wHead is read with acquire semantics.           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle.                          *
+*   - pDate: Pointer to the data to be enqueued.                         *
+*   - wDataLength: Number of bytes to enqueue.                            *
+* Returns: Number of bytes actually enqueued.                             *
+****************************************************************************/
+uint32_t shm_enqueue_bytes(shm_queue_t *ptObj, const void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shm_queue_t *ptThis = (shm_queue_t *)ptObj;
+    const uint8_t *pchByte = pDate;
+    uint32_t wTail = __atomic_load_n(&this.ptCtrl->wTail, __ATOMIC_RELAXED);  // Owned by the producer
+    uint32_t wHead = __atomic_load_n(&this.ptCtrl->wHead, __ATOMIC_ACQUIRE);
+    uint32_t wFree = this.wMask + 1 - (wTail - wHead);
+    if (wDataLength > wFree) {  // If not enough space
+        wDataLength = wFree;  // Adjust data length
+    }
+    if (0 == wDataLength) {
+        return 0;
+    }
+    uint32_t wIndex = wTail & this.wMask;
+    uint32_t wFirst = this.wMask + 1 - wIndex;
+    if (wDataLength <= wFirst) {
+        memcpy(&this.pchBuffer[wIndex], pchByte, wDataLength);  // Copy data to buffer
+    } else {
+        memcpy(&this.pchBuffer[wIndex], &pchByte[0], wFirst);  // Copy first part
+        memcpy(&this.pchBuffer[0], &pchByte[wFirst], wDataLength - wFirst);  // Copy second part
+    }
+    __atomic_store_n(&this.ptCtrl->wTail, wTail + wDataLength, __ATOMIC_RELEASE);  // Publish the data
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: shm_dequeue_bytes                                             *
+* Description: Dequeues bytes, consumer side. Only wHead is written, the  *
+*              producer's wTail is read with acquire semantics.           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle.                          *
+*   - pDate: Pointer to store the dequeued data.                         *
+*   - wDataLength: Number of bytes to dequeue.                            *
+* Returns: Number of bytes actually dequeued.                             *
+****************************************************************************/
+uint32_t shm_dequeue_bytes(shm_queue_t *ptObj, void *pDate, uint32_t wDataLength)
+{
+    assert(NULL != ptObj);  // Ensure ptObj is not NULL
+    assert(NULL != pDate);  // Ensure pDate is not NULL
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shm_queue_t *ptThis = (shm_queue_t *)ptObj;
+    uint8_t *pchByte = pDate;
+    uint32_t wHead = __atomic_load_n(&this.ptCtrl->wHead, __ATOMIC_RELAXED);  // Owned by the consumer
+    uint32_t wTail = __atomic_load_n(&this.ptCtrl->wTail, __ATOMIC_ACQUIRE);
+    if (wDataLength > wTail - wHead) {  // If requested length exceeds available data
+        wDataLength = wTail - wHead;  // Adjust data length
+    }
+    if (0 == wDataLength) {
+        return 0;
+    }
+    uint32_t wIndex = wHead & this.wMask;
+    uint32_t wFirst = this.wMask + 1 - wIndex;
+    if (wDataLength <= wFirst) {
+        memcpy(pchByte, &this.pchBuffer[wIndex], wDataLength);  // Copy data from buffer
+    } else {
+        memcpy(&pchByte[0], &this.pchBuffer[wIndex], wFirst);  // Copy first part
+        memcpy(&pchByte[wFirst], &this.pchBuffer[0], wDataLength - wFirst);  // Copy second part
+    }
+    __atomic_store_n(&this.ptCtrl->wHead, wHead + wDataLength, __ATOMIC_RELEASE);  // Hand the space back
+    return wDataLength;
+}
+
+/****************************************************************************
+* Function: is_shm_queue_empty                                            *
+* Description: Checks if the shared memory byte queue is empty.           *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle.                          *
+* Returns: True if the queue is empty, false otherwise.                  *
+****************************************************************************/
+bool is_shm_queue_empty(shm_queue_t *ptObj)
+{
+    return 0 == get_shm_queue_count(ptObj);
+}
+
+/****************************************************************************
+* Function: get_shm_queue_count                                           *
+* Description: Gets the number of bytes in the shared memory byte queue.  *
+* Parameters:                                                             *
+*   - ptObj: Pointer to the shm_queue_t handle.                          *
+* Returns: Number of bytes in the queue.                                  *
+****************************************************************************/
+uint32_t get_shm_queue_count(shm_queue_t *ptObj)
+{
+    assert(NULL != ptObj);
+    /* initialise "this" (i.e. ptThis) to access class members */
+    shm_queue_t *ptThis = (shm_queue_t *)ptObj;
+    uint32_t wHead = __atomic_load_n(&this.ptCtrl->wHead, __ATOMIC_ACQUIRE);
+    uint32_t wTail = __atomic_load_n(&this.ptCtrl->wTail, __ATOMIC_ACQUIRE);
+    if (wTail - wHead > this.wMask + 1) {  // wHead was read before both sides moved on
+        return this.wMask + 1;
+    }
+    return wTail - wHead;
+}
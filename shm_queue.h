@@ -0,0 +1,125 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+
+#ifndef QUEUE_SHM_QUEUE_H_
+#define QUEUE_SHM_QUEUE_H_
+#include "byte_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Layout of the shared memory object: this control block followed by
+ *        the data area at wDataOffset.
+ *
+ * \details Everything in here is position independent, the head and tail are
+ *          free-running byte counters, so each process may map the object at
+ *          a different address. The counters are always 32 bits wide whatever
+ *          QUEUE_CFG_WIDE_INDEX says.
+ */
+typedef struct shm_queue_ctrl_t {
+    uint32_t wMagic;                            /* set last by the creator */
+    uint32_t wSize;                             /* data area size, a power of two */
+    uint32_t wDataOffset;                       /* data area, from the block start */
+    __QUEUE_CACHE_ALIGNED uint32_t wTail;      /* written by the producer */
+    __QUEUE_CACHE_ALIGNED uint32_t wHead;      /* written by the consumer */
+} shm_queue_ctrl_t;
+
+/*!
+ * \brief Process-local handle of a shared memory byte queue.
+ *
+ * \details One process enqueues and one process dequeues (SPSC). Both sides
+ *          only use lock-free acquire/release operations on the control block,
+ *          so no lock has to be shared between the processes.
+ */
+typedef struct shm_queue_t {
+    shm_queue_ctrl_t *ptCtrl;
+    uint8_t *pchBuffer;
+    uint32_t wMask;
+    size_t tMapSize;
+} shm_queue_t;
+
+/*!
+ * \brief Create a named shared memory queue and map it.
+ *
+ * \param[in] ptObj pointer to the queue handle.
+ * \param[in] pchName name for shm_open(), e.g. "/my_queue".
+ * \param[in] wSize size of the data area in bytes, must be a power of two.
+ *
+ * \return the address of the handle, or NULL if the name already exists or
+ *         the object can not be set up.
+ *
+ * \details Here is an example:
+    E.g.
+    \code
+        // producer process
+        static shm_queue_t s_tQueue;
+        shm_queue_create(&s_tQueue, "/sensor_queue", 65536);
+        shm_enqueue_bytes(&s_tQueue, chFrame, sizeof(chFrame));
+
+        // consumer process
+        static shm_queue_t s_tQueue;
+        shm_queue_attach(&s_tQueue, "/sensor_queue");
+        shm_dequeue_bytes(&s_tQueue, chFrame, sizeof(chFrame));
+    \endcode
+ */
+extern
+shm_queue_t *shm_queue_create(shm_queue_t *ptObj, const char *pchName, uint32_t wSize);
+
+/*!
+ * \brief Map a queue created by another process with shm_queue_create().
+ *
+ * \param[in] ptObj pointer to the queue handle.
+ * \param[in] pchName name given to shm_queue_create().
+ *
+ * \return the address of the handle, or NULL if there is no such queue yet or
+ *         it was created by a build with a different layout.
+ */
+extern
+shm_queue_t *shm_queue_attach(shm_queue_t *ptObj, const char *pchName);
+
+/*!
+ * \brief Unmap the queue from this process. The queue itself survives.
+ */
+extern
+bool shm_queue_detach(shm_queue_t *ptObj);
+
+/*!
+ * \brief Remove the name of a queue. Processes that have it mapped keep using
+ *        it until they detach.
+ */
+extern
+bool shm_queue_destroy(const char *pchName);
+
+extern
+uint32_t shm_enqueue_bytes(shm_queue_t *ptObj, const void *pDate, uint32_t wDataLength);
+
+extern
+uint32_t shm_dequeue_bytes(shm_queue_t *ptObj, void *pDate, uint32_t wDataLength);
+
+extern
+bool is_shm_queue_empty(shm_queue_t *ptObj);
+
+extern
+uint32_t get_shm_queue_count(shm_queue_t *ptObj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_SHM_QUEUE_H_ */
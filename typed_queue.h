@@ -0,0 +1,143 @@
+/****************************************************************************
+*  Copyright 2022 KK (https://github.com/Aladdin-Wang)                                    *
+*                                                                           *
+*  Licensed under the Apache License, Version 2.0 (the "License");          *
+*  you may not use this file except in compliance with the License.         *
+*  You may obtain a copy of the License at                                  *
+*                                                                           *
+*     http://www.apache.org/licenses/LICENSE-2.0                            *
+*                                                                           *
+*  Unless required by applicable law or agreed to in writing, software      *
+*  distributed under the License is distributed on an "AS IS" BASIS,        *
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+*  See the License for the specific language governing permissions and      *
+*  limitations under the License.                                           *
+*                                                                           *
+****************************************************************************/
+#ifndef QUEUE_TYPED_QUEUE_H_
+#define QUEUE_TYPED_QUEUE_H_
+#include "byte_queue.h"
+
+/*!
+ * \brief Define a queue of N items of type T with its storage inside the
+ *        queue object, and the functions working on it.
+ *
+ * \param[in] __NAME prefix of the generated type and functions.
+ * \param[in] __TYPE item type, copied by plain assignment.
+ * \param[in] __SIZE number of items, a constant from 1 to 0x7FFFFFFF.
+ *
+ * \details The generated functions are specialised for the item type: they
+ *          index items instead of bytes and copy with assignment instead of
+ *          memcpy(). wHead and wTail run from 0 to 2 * __SIZE - 1 so a full
+ *          queue can be told from an empty one without a length field; a
+ *          power-of-two __SIZE turns the wrap into a mask. A bad __SIZE
+ *          fails to compile.
+ *
+ *          One context may push and one other context may pop/peek at the
+ *          same time without a lock, like queue_init_spsc(). Wrap the calls
+ *          in safe_atom_code() when several contexts share a side. The
+ *          byte_queue_t API stays the choice for variable length data.
+    E.g.
+    \code
+        DEFINE_TYPED_QUEUE(sample_queue, uint32_t, 256)
+
+        static sample_queue_t s_tSamples;
+        sample_queue_init(&s_tSamples);
+        sample_queue_push(&s_tSamples, 0x55AAAA55);
+        uint32_t wSample;
+        while (sample_queue_pop(&s_tSamples, &wSample)) {
+            ...
+        }
+    \endcode
+ */
+#define DEFINE_TYPED_QUEUE(__NAME, __TYPE, __SIZE)                             \
+typedef char __NAME##_size_check_t                                             \
+    [((__SIZE) > 0 && (__SIZE) <= 0x7FFFFFFF) ? 1 : -1];                       \
+                                                                               \
+typedef struct __NAME##_t {                                                    \
+    __TYPE tBuffer[__SIZE];                                                    \
+    __QUEUE_CACHE_ALIGNED uint32_t wTail;      /* written by the producer */   \
+    __QUEUE_CACHE_ALIGNED uint32_t wHead;      /* written by the consumer */   \
+} __NAME##_t;                                                                  \
+                                                                               \
+static inline uint32_t __NAME##_slot(uint32_t wIndex)                          \
+{                                                                              \
+    if (0 == ((__SIZE) & ((__SIZE) - 1))) {                                    \
+        return wIndex & ((uint32_t)(__SIZE) - 1);                              \
+    }                                                                          \
+    return (wIndex < (uint32_t)(__SIZE)) ? wIndex                             \
+                                         : wIndex - (uint32_t)(__SIZE);        \
+}                                                                              \
+                                                                               \
+static inline uint32_t __NAME##_next(uint32_t wIndex)                          \
+{                                                                              \
+    if (0 == ((__SIZE) & ((__SIZE) - 1))) {                                    \
+        return (wIndex + 1) & (2 * (uint32_t)(__SIZE) - 1);                    \
+    }                                                                          \
+    return (wIndex + 1 == 2 * (uint32_t)(__SIZE)) ? 0 : wIndex + 1;            \
+}                                                                              \
+                                                                               \
+static inline uint32_t __NAME##_distance(uint32_t wTail, uint32_t wHead)       \
+{                                                                              \
+    return (wTail >= wHead) ? wTail - wHead                                    \
+                            : wTail + 2 * (uint32_t)(__SIZE) - wHead;          \
+}                                                                              \
+                                                                               \
+static inline __NAME##_t *__NAME##_init(__NAME##_t *ptObj)                     \
+{                                                                              \
+    assert(NULL != ptObj);                                                     \
+    ptObj->wTail = 0;                                                          \
+    ptObj->wHead = 0;                                                          \
+    __atomic_thread_fence(__ATOMIC_RELEASE);                                   \
+    return ptObj;                                                              \
+}                                                                              \
+                                                                               \
+static inline bool __NAME##_push(__NAME##_t *ptObj, __TYPE tItem)              \
+{                                                                              \
+    uint32_t wTail = ptObj->wTail;  /* Owned by the producer */                \
+    uint32_t wHead = __atomic_load_n(&ptObj->wHead, __ATOMIC_ACQUIRE);         \
+    if (__NAME##_distance(wTail, wHead) == (uint32_t)(__SIZE)) {               \
+        return false;  /* The queue is full */                                 \
+    }                                                                          \
+    ptObj->tBuffer[__NAME##_slot(wTail)] = tItem;                              \
+    __atomic_store_n(&ptObj->wTail, __NAME##_next(wTail), __ATOMIC_RELEASE);   \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline bool __NAME##_peek(__NAME##_t *ptObj, __TYPE *ptItem)            \
+{                                                                              \
+    uint32_t wHead = ptObj->wHead;  /* Owned by the consumer */                \
+    if (__atomic_load_n(&ptObj->wTail, __ATOMIC_ACQUIRE) == wHead) {           \
+        return false;  /* The queue is empty */                                \
+    }                                                                          \
+    *ptItem = ptObj->tBuffer[__NAME##_slot(wHead)];                            \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline bool __NAME##_pop(__NAME##_t *ptObj, __TYPE *ptItem)             \
+{                                                                              \
+    uint32_t wHead = ptObj->wHead;  /* Owned by the consumer */                \
+    if (__atomic_load_n(&ptObj->wTail, __ATOMIC_ACQUIRE) == wHead) {           \
+        return false;  /* The queue is empty */                                \
+    }                                                                          \
+    *ptItem = ptObj->tBuffer[__NAME##_slot(wHead)];                            \
+    __atomic_store_n(&ptObj->wHead, __NAME##_next(wHead), __ATOMIC_RELEASE);   \
+    return true;                                                               \
+}                                                                              \
+                                                                               \
+static inline bool is_##__NAME##_empty(__NAME##_t *ptObj)                      \
+{                                                                              \
+    return __atomic_load_n(&ptObj->wTail, __ATOMIC_ACQUIRE)                    \
+        == __atomic_load_n(&ptObj->wHead, __ATOMIC_ACQUIRE);                   \
+}                                                                              \
+                                                                               \
+static inline uint32_t get_##__NAME##_count(__NAME##_t *ptObj)                 \
+{                                                                              \
+    uint32_t wHead = __atomic_load_n(&ptObj->wHead, __ATOMIC_ACQUIRE);         \
+    uint32_t wTail = __atomic_load_n(&ptObj->wTail, __ATOMIC_ACQUIRE);         \
+    uint32_t wCount = __NAME##_distance(wTail, wHead);                         \
+    /* both sides may have moved between the two loads */                      \
+    return (wCount > (uint32_t)(__SIZE)) ? (uint32_t)(__SIZE) : wCount;        \
+}
+
+#endif /* QUEUE_TYPED_QUEUE_H_ */